@@ -6,23 +6,49 @@ struct buddy_block {
 };
 
 struct buddy_metadata {
-	BuddyBlock* freeChunks[MAX_BLOCK_DEG];
-	BuddyBlock* startingAddress;
+	ArenaOffset freeChunks[MAX_BLOCK_DEG];
+	ArenaOffset quickChunks[QUICK_MAX_DEG]; //skoro oslobodjeni chunkovi malog stepena, nespojeni sa partnerima
+	int quickCount[QUICK_MAX_DEG];
+	ArenaOffset startingOffset, root;
+	size_t usedBlocks, peakBlocks;
 };
 
-BuddyMetadata* buddy_init(void* space, int num_blocks) {
+#define BUDDY_START(buddy) ((BuddyBlock*) ARENA_POINTER(buddy, (buddy)->startingOffset))
+
+//koren korisnika (root_size bajtova) deli blokove metapodataka, pa ne zauzima ceo blok
+BuddyMetadata* buddy_init(void* space, size_t num_blocks, size_t root_size) {
 	
 	BuddyMetadata* metadata = space;
-	int blocksNeeded = sizeof(BuddyMetadata) / BLOCK_SIZE + (sizeof(BuddyMetadata)%BLOCK_SIZE == 0 ? 0 : 1);
+	size_t rootOffset = (sizeof(BuddyMetadata) + 15) & ~(size_t) 15; //koren je poravnat za Interlocked operacije
+	size_t metadataSize = rootOffset + root_size;
+	size_t blocksNeeded = metadataSize / BLOCK_SIZE + (metadataSize % BLOCK_SIZE == 0 ? 0 : 1);
 	//printf("Blokova potrebno za metadata: %d\n", blocksNeeded);
 	BuddyBlock* currentChunk = ((char*) space) + blocksNeeded * BLOCK_SIZE;
+	if (num_blocks < blocksNeeded) return NULL; //nije dato dovoljno mesta
 	num_blocks-= blocksNeeded;
-	if (num_blocks < 0) return NULL; //nije dato dovoljno mesta
 
 	for (int i = 0; i < MAX_BLOCK_DEG; metadata->freeChunks[i++] = 0);
-	metadata->startingAddress = currentChunk;
+	for (int i = 0; i < QUICK_MAX_DEG; i++) {
+		metadata->quickChunks[i] = 0;
+		metadata->quickCount[i] = 0;
+	}
+	metadata->startingOffset = ARENA_OFFSET(metadata, currentChunk);
+	metadata->root = root_size > 0 ? ARENA_OFFSET(metadata, (char*) space + rootOffset) : 0;
+	metadata->usedBlocks = metadata->peakBlocks = 0;
 	//printf("pocetna adresa: %d\n", currentChunk);
-	int degNum = 0, mask = 1, tempNum = num_blocks;
+
+	//arena veca od najveceg chunka se deli na vise chunkova najveceg stepena
+	size_t maxChunkBlocks = (size_t) 1 << (MAX_BLOCK_DEG - 1);
+	while (num_blocks >= maxChunkBlocks) {
+		ArenaOffset* nextChunk = currentChunk;
+		*nextChunk = metadata->freeChunks[MAX_BLOCK_DEG - 1];
+		metadata->freeChunks[MAX_BLOCK_DEG - 1] = ARENA_OFFSET(metadata, currentChunk);
+		currentChunk += maxChunkBlocks;
+		num_blocks -= maxChunkBlocks;
+	}
+
+	int degNum = 0;
+	size_t mask = 1, tempNum = num_blocks;
 
 	while (tempNum > 1) {
 		++degNum;
@@ -30,10 +56,11 @@ BuddyMetadata* buddy_init(void* space, int num_blocks) {
 		tempNum >>= 1;
 	}
 
-	for (int i = degNum, j = mask; i >= 0; --i, j>>=1){
+	size_t j = mask;
+	for (int i = degNum; i >= 0; --i, j>>=1){
 		if (num_blocks & j){ 
-			metadata->freeChunks[i] = currentChunk;
-			BuddyBlock** nextChunk = currentChunk;
+			metadata->freeChunks[i] = ARENA_OFFSET(metadata, currentChunk);
+			ArenaOffset* nextChunk = currentChunk;
 			*nextChunk = 0;
 			currentChunk += j;
 			//printf("dodat chunk velicine %d,degNum %d, adresa %d\n", j,i, metadata->freeChunks[i]);
@@ -49,29 +76,63 @@ void buddy_print(BuddyMetadata* buddy) {
 	for (int i = 0; i < MAX_BLOCK_DEG; i++) {
 		if (buddy->freeChunks[i] != 0) {
 			printf("2 ^ %d : ", i);
-			BuddyBlock* currBlock = buddy->freeChunks[i];
+			BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->freeChunks[i]);
 			int counter = 0;
 			while (currBlock) {
-				int index = currBlock - buddy->startingAddress;
-				printf("%d, ", index);
+				size_t index = currBlock - BUDDY_START(buddy);
+				printf("%zu, ", index);
 				counter++;
-				BuddyBlock** nextBlock = currBlock;
-				currBlock = *nextBlock;
+				ArenaOffset* nextBlock = currBlock;
+				currBlock = ARENA_POINTER(buddy, *nextBlock);
 			}
 			printf("= %d chunkova\n", counter);
 		}
 	}
+	for (int i = 0; i < QUICK_MAX_DEG; i++) {
+		if (buddy->quickChunks[i] != 0) {
+			printf("brza lista 2 ^ %d : ", i);
+			BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->quickChunks[i]);
+			while (currBlock) {
+				size_t index = currBlock - BUDDY_START(buddy);
+				printf("%zu, ", index);
+				ArenaOffset* nextBlock = currBlock;
+				currBlock = ARENA_POINTER(buddy, *nextBlock);
+			}
+			printf("= %d chunkova\n", buddy->quickCount[i]);
+		}
+	}
 	printf("--------\n");
 }
 
-void buddy_calc_chunk_size(size_t size, int* degReqAddr, int* degBlkAddr) {
+void buddy_get_stats(BuddyMetadata* buddy, BuddyStats* stats) {
+	stats->usedBlocks = buddy->usedBlocks;
+	stats->peakBlocks = buddy->peakBlocks;
+	stats->freeBlocks = stats->largestChunk = 0;
+	for (int i = 0; i < MAX_BLOCK_DEG; i++) {
+		BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->freeChunks[i]);
+		while (currBlock) {
+			stats->freeBlocks += (size_t) 1 << i;
+			stats->largestChunk = (size_t) 1 << i;
+			ArenaOffset* nextBlock = currBlock;
+			currBlock = ARENA_POINTER(buddy, *nextBlock);
+		}
+	}
+	for (int i = 0; i < QUICK_MAX_DEG; i++) {
+		stats->freeBlocks += (size_t) buddy->quickCount[i] << i;
+		if (buddy->quickCount[i] > 0 && stats->largestChunk < (size_t) 1 << i)
+			stats->largestChunk = (size_t) 1 << i;
+	}
+}
 
-	int blocksRequired = size / BLOCK_SIZE;
+void buddy_calc_chunk_size(size_t size, int* degReqAddr, size_t* degBlkAddr) {
+
+	size_t blocksRequired = size / BLOCK_SIZE;
 	if (size > blocksRequired * BLOCK_SIZE)
 		++blocksRequired;
 	//printf("Potrebno %d blokova, ", blocksRequired);
 
-	int degRequired = 0, needsBigger = 0, degBlocks = 1;
+	int degRequired = 0, needsBigger = 0;
+	size_t degBlocks = 1;
 	while (blocksRequired > 1) {
 		degRequired++;
 		degBlocks <<= 1;
@@ -86,16 +147,11 @@ void buddy_calc_chunk_size(size_t size, int* degReqAddr, int* degBlkAddr) {
 	*degBlkAddr = degBlocks;
 }
 
-void* buddy_take(BuddyMetadata* buddy, size_t size) {
-
-	int degRequired, degBlocks;
-
-	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
-
+void* buddy_take_chunk(BuddyMetadata* buddy, int degRequired, size_t degBlocks) {
 	for (int i = degRequired; i < MAX_BLOCK_DEG; ++i, degBlocks <<= 1) {
 		if (buddy->freeChunks[i] != 0) {
-			BuddyBlock* retVal = buddy->freeChunks[i];
-			BuddyBlock** nextChunk = retVal;
+			BuddyBlock* retVal = ARENA_POINTER(buddy, buddy->freeChunks[i]);
+			ArenaOffset* nextChunk = retVal;
 			buddy->freeChunks[i] = *nextChunk;
 			//printf("uzeo chunk stepena %d\n", i);
 
@@ -103,13 +159,16 @@ void* buddy_take(BuddyMetadata* buddy, size_t size) {
 				degBlocks >>= 1;
 				--i;
 				BuddyBlock* leftoverChunk = retVal + degBlocks;
-				BuddyBlock** nextLeftover = leftoverChunk;
+				ArenaOffset* nextLeftover = leftoverChunk;
 				*nextLeftover = buddy->freeChunks[i];
-				buddy->freeChunks[i] = leftoverChunk;
+				buddy->freeChunks[i] = ARENA_OFFSET(buddy, leftoverChunk);
 				//printf("cepanje chunka na dva dela stepena %d\n", i);
 			}
+			buddy->usedBlocks += degBlocks;
+			if (buddy->usedBlocks > buddy->peakBlocks)
+				buddy->peakBlocks = buddy->usedBlocks;
 			//buddy_print(buddy);
-			//int index = retVal - buddy->startingAddress;
+			//int index = retVal - BUDDY_START(buddy);
 			//printf("take %d, size %d\n", index, degBlocks);
 			return retVal;
 		}
@@ -118,33 +177,26 @@ void* buddy_take(BuddyMetadata* buddy, size_t size) {
 	return NULL;
 }
 
-void buddy_give(BuddyMetadata* buddy, void* block, size_t size) {
-	int degRequired, degBlocks;
-
-	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
-
-	BuddyBlock* blockPointer = block;
-	int index = blockPointer - buddy->startingAddress;
+void buddy_coalesce(BuddyMetadata* buddy, BuddyBlock* blockPointer, int degRequired, size_t degBlocks) {
+	size_t index = blockPointer - BUDDY_START(buddy);
 	//printf("indeks pocetka chunka: %d\n", index);
-
-	//printf("give %d, size %d\n", index, degBlocks);
 	
-	while(1){
+	while(degRequired < MAX_BLOCK_DEG - 1){ //chunkovi najveceg stepena se ne spajaju
 		BuddyBlock* partnerPointer = (index % (degBlocks * 2) == 0) ? blockPointer + degBlocks : blockPointer - degBlocks;
-		int partnerIndex = partnerPointer - buddy->startingAddress;
+		size_t partnerIndex = partnerPointer - BUDDY_START(buddy);
 		//printf("indeks pocetka partnera: %d\n", partnerIndex);
 
-		BuddyBlock* currBlock = buddy->freeChunks[degRequired], *prevBlock = 0;
+		BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->freeChunks[degRequired]), *prevBlock = 0;
 		while (currBlock && currBlock != partnerPointer) {
-			BuddyBlock** nextBlock = currBlock;
+			ArenaOffset* nextBlock = currBlock;
 			prevBlock = currBlock;
-			currBlock = *nextBlock;
+			currBlock = ARENA_POINTER(buddy, *nextBlock);
 		}
 
 		if (currBlock) {
-			BuddyBlock** nextBlock = currBlock;
+			ArenaOffset* nextBlock = currBlock;
 			if (prevBlock) {
-				BuddyBlock** prevNextBlock = prevBlock;
+				ArenaOffset* prevNextBlock = prevBlock;
 				*prevNextBlock = *nextBlock;
 			}
 			else buddy->freeChunks[degRequired] = *nextBlock;
@@ -163,10 +215,138 @@ void buddy_give(BuddyMetadata* buddy, void* block, size_t size) {
 		break; }
 	}
 
-	BuddyBlock** nextBlock = blockPointer;
+	ArenaOffset* nextBlock = blockPointer;
 	*nextBlock = buddy->freeChunks[degRequired];
-	buddy->freeChunks[degRequired] = blockPointer;
+	buddy->freeChunks[degRequired] = ARENA_OFFSET(buddy, blockPointer);
 
 	//buddy_print(buddy);
 	//putchar('\n');
+}
+
+void buddy_flush_quick(BuddyMetadata* buddy, int deg) {
+	BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->quickChunks[deg]);
+	while (currBlock) {
+		ArenaOffset* nextBlock = currBlock;
+		BuddyBlock* next = ARENA_POINTER(buddy, *nextBlock);
+		buddy_coalesce(buddy, currBlock, deg, 1 << deg);
+		currBlock = next;
+	}
+	buddy->quickChunks[deg] = 0;
+	buddy->quickCount[deg] = 0;
+}
+
+void buddy_flush_all_quick(BuddyMetadata* buddy) {
+	for (int i = 0; i < QUICK_MAX_DEG; i++)
+		if (buddy->quickChunks[i] != 0)
+			buddy_flush_quick(buddy, i);
+}
+
+void* buddy_take(BuddyMetadata* buddy, size_t size) {
+
+	int degRequired;
+	size_t degBlocks;
+
+	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
+
+	if (degRequired < QUICK_MAX_DEG && buddy->quickChunks[degRequired] != 0) {
+		BuddyBlock* retVal = ARENA_POINTER(buddy, buddy->quickChunks[degRequired]);
+		ArenaOffset* nextChunk = retVal;
+		buddy->quickChunks[degRequired] = *nextChunk;
+		--(buddy->quickCount[degRequired]);
+		buddy->usedBlocks += degBlocks;
+		if (buddy->usedBlocks > buddy->peakBlocks)
+			buddy->peakBlocks = buddy->usedBlocks;
+		return retVal;
+	}
+
+	void* retVal = buddy_take_chunk(buddy, degRequired, degBlocks);
+	if (retVal == NULL) {
+		//tek kada zahtev ne moze da se ispuni, chunkovi iz brzih lista se spajaju sa partnerima
+		buddy_flush_all_quick(buddy);
+		retVal = buddy_take_chunk(buddy, degRequired, degBlocks);
+	}
+	return retVal;
+}
+
+void buddy_give(BuddyMetadata* buddy, void* block, size_t size) {
+	int degRequired;
+	size_t degBlocks;
+
+	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
+
+	//printf("give %d, size %d\n", (BuddyBlock*) block - BUDDY_START(buddy), degBlocks);
+	buddy->usedBlocks -= degBlocks;
+
+	if (degRequired < QUICK_MAX_DEG) {
+		if (buddy->quickCount[degRequired] == QUICK_WATERMARK)
+			buddy_flush_quick(buddy, degRequired);
+		ArenaOffset* nextChunk = block;
+		*nextChunk = buddy->quickChunks[degRequired];
+		buddy->quickChunks[degRequired] = ARENA_OFFSET(buddy, block);
+		++(buddy->quickCount[degRequired]);
+		return;
+	}
+
+	buddy_coalesce(buddy, block, degRequired, degBlocks);
+}
+
+size_t buddy_chunk_size(size_t size) {
+	int degRequired;
+	size_t degBlocks;
+	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
+	return degBlocks * BLOCK_SIZE;
+}
+
+int buddy_find_free(BuddyMetadata* buddy, int deg, BuddyBlock* chunk, int remove) {
+	BuddyBlock* currBlock = ARENA_POINTER(buddy, buddy->freeChunks[deg]), *prevBlock = 0;
+	while (currBlock && currBlock != chunk) {
+		ArenaOffset* nextBlock = currBlock;
+		prevBlock = currBlock;
+		currBlock = ARENA_POINTER(buddy, *nextBlock);
+	}
+	if (!currBlock) return 0;
+
+	if (remove) {
+		ArenaOffset* nextBlock = currBlock;
+		if (prevBlock) {
+			ArenaOffset* prevNextBlock = prevBlock;
+			*prevNextBlock = *nextBlock;
+		}
+		else buddy->freeChunks[deg] = *nextBlock;
+	}
+	return 1;
+}
+
+int buddy_grow(BuddyMetadata* buddy, void* block, size_t size, size_t newSize) {
+	int degRequired, newDeg;
+	size_t degBlocks, newBlocks;
+
+	buddy_calc_chunk_size(size, &degRequired, &degBlocks);
+	buddy_calc_chunk_size(newSize, &newDeg, &newBlocks);
+	if (newDeg <= degRequired) return 1; //vec staje
+	if (newDeg >= MAX_BLOCK_DEG) return 0; //veci od najveceg chunka
+
+	BuddyBlock* blockPointer = block;
+	size_t index = blockPointer - BUDDY_START(buddy);
+	if (index % newBlocks != 0) return 0; //chunk mora biti levi partner na svakom nivou do novog stepena
+
+	buddy_flush_all_quick(buddy); //partner moze biti u brzoj listi
+
+	//desni partner na svakom nivou mora biti slobodan, tek onda se svi preuzimaju
+	size_t j = degBlocks;
+	for (int i = degRequired; i < newDeg; ++i, j <<= 1)
+		if (!buddy_find_free(buddy, i, blockPointer + j, 0)) return 0;
+	j = degBlocks;
+	for (int i = degRequired; i < newDeg; ++i, j <<= 1)
+		buddy_find_free(buddy, i, blockPointer + j, 1);
+
+	buddy->usedBlocks += newBlocks - degBlocks;
+	if (buddy->usedBlocks > buddy->peakBlocks)
+		buddy->peakBlocks = buddy->usedBlocks;
+	//printf("grow %d, size %d -> %d\n", index, degBlocks, newBlocks);
+	return 1;
+}
+
+void* buddy_get_root(BuddyMetadata* buddy) {
+	return ARENA_POINTER(buddy, buddy->root);
 }
\ No newline at end of file
@@ -1,19 +1,48 @@
 #pragma once
 #include "slab.h"
 
+#ifndef MAX_BLOCK_DEG
 #define MAX_BLOCK_DEG 30
-//sizeof(int) = 32b -> MAX_INT = 2^31 - 1, stoga je dovoljna velicina niza 30
-//ako je int veci od 32b onda je problem...
+#endif
+//najveci chunk ima 2^(MAX_BLOCK_DEG - 1) blokova, sto je za blokove od 4KB 2TB
+//veca arena se deli na vise chunkova najveceg stepena, pa velicina niza ogranicava samo velicinu jedne alokacije
+
+#define QUICK_MAX_DEG 4
+#define QUICK_WATERMARK 16
+//oslobodjeni chunkovi stepena manjeg od QUICK_MAX_DEG se ne spajaju odmah, vec cekaju u brzoj listi
+//dok se lista ne napuni do QUICK_WATERMARK ili dok zahtev ne moze da se ispuni bez spajanja
+
+//pokazivaci unutar arene se cuvaju kao pomeraj od njenog pocetka, pa arena moze biti mapirana na razlicite adrese
+//pomeraj 0 je NULL, jer su na pocetku arene uvek metapodaci buddy alokatora
+typedef size_t ArenaOffset;
+#define ARENA_OFFSET(base, pointer) ((pointer) == NULL ? (ArenaOffset) 0 : (ArenaOffset)((char*)(pointer) - (char*)(base)))
+#define ARENA_POINTER(base, offset) ((offset) == 0 ? NULL : (void*)((char*)(base) + (offset)))
 
 typedef struct buddy_block BuddyBlock;
 
 typedef struct buddy_metadata BuddyMetadata;
 
+typedef struct buddy_stats {
+	size_t usedBlocks, peakBlocks, freeBlocks, largestChunk;
+} BuddyStats;
 
-BuddyMetadata* buddy_init(void* space, int block_num);
+
+BuddyMetadata* buddy_init(void* space, size_t block_num, size_t root_size);
 
 void* buddy_take(BuddyMetadata* buddy, size_t size);
 
 void buddy_give(BuddyMetadata* buddy, void* block, size_t size);
 
-void buddy_print(BuddyMetadata* buddy);
\ No newline at end of file
+int buddy_grow(BuddyMetadata* buddy, void* block, size_t size, size_t newSize);
+
+size_t buddy_chunk_size(size_t size);
+
+void buddy_print(BuddyMetadata* buddy);
+
+void buddy_get_stats(BuddyMetadata* buddy, BuddyStats* stats);
+
+void* buddy_get_root(BuddyMetadata* buddy);
+
+void kmem_arena_stats(BuddyStats* stats); // Arena usage (blocks), taken under the allocator lock
+void* kmem_chunk_take(size_t size); // Chunk straight from the arena, taken under the allocator lock
+void kmem_chunk_give(void* chunk, size_t size); // Return a chunk from kmem_chunk_take
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "epoch.h"
+#include <windows.h>
+
+typedef struct epoch_bag {
+	LONG epoch;
+	kmem_cache_t** caches; //odlozeni objekti se ne povezuju kroz sebe, jer ih citaoci mozda jos koriste
+	void** objects;
+	int count, capacity;
+} EpochBag;
+
+typedef struct epoch_thread {
+	volatile LONG owner, active, epoch;
+	int nesting;
+	EpochBag bags[EPOCH_BAGS]; //kesa za epohu e je na poziciji e % EPOCH_BAGS
+} EpochThread;
+
+volatile LONG globalEpoch = 0;
+EpochThread epochThreads[EPOCH_MAX_THREADS];
+
+__declspec(thread) int epochSlot = -1;
+
+EpochThread* getEpochThread() {
+	if (epochSlot >= 0) return &epochThreads[epochSlot];
+
+	LONG self = (LONG) GetCurrentThreadId();
+	for (int i = 0; i < EPOCH_MAX_THREADS; i++) {
+		if (InterlockedCompareExchange(&epochThreads[i].owner, self, 0) == 0) {
+			epochSlot = i;
+			return &epochThreads[i];
+		}
+	}
+	return NULL; //sva mesta za niti su zauzeta
+}
+
+LONG currentEpoch() {
+	return InterlockedCompareExchange(&globalEpoch, 0, 0); //citanje sa barijerom
+}
+
+int kmem_epoch_enter()
+{
+	EpochThread* record = getEpochThread();
+	if (record == NULL) return 0;
+
+	if (record->nesting++ == 0) {
+		record->epoch = globalEpoch;
+		InterlockedExchange(&record->active, 1); //barijera, epoha mora biti vidljiva pre prvog citanja strukture
+	}
+	return 1;
+}
+
+void kmem_epoch_exit()
+{
+	if (epochSlot < 0) return; //nit nije u sekciji citanja
+
+	EpochThread* record = &epochThreads[epochSlot];
+	if (record->nesting > 0 && --(record->nesting) == 0)
+		InterlockedExchange(&record->active, 0);
+}
+
+void tryAdvanceEpoch() {
+	LONG epoch = currentEpoch();
+	for (int i = 0; i < EPOCH_MAX_THREADS; i++)
+		if (epochThreads[i].active && epochThreads[i].epoch != epoch) return; //nit je jos u prethodnoj epohi
+	InterlockedCompareExchange(&globalEpoch, epoch + 1, epoch);
+}
+
+//objekti istog kesa odlozeni jedan za drugim se vracaju jednim pozivom
+void reclaimBag(EpochBag* bag) {
+	int start = 0;
+	for (int i = 1; i <= bag->count; i++) {
+		if (i == bag->count || bag->caches[i] != bag->caches[start]) {
+			kmem_cache_free_bulk(bag->caches[start], i - start, &bag->objects[start]);
+			start = i;
+		}
+	}
+	bag->count = 0;
+}
+
+void reclaimExpired(EpochThread* record) {
+	LONG epoch = currentEpoch();
+	for (int i = 0; i < EPOCH_BAGS; i++)
+		if (record->bags[i].count > 0 && epoch - record->bags[i].epoch >= 2)
+			reclaimBag(&record->bags[i]);
+}
+
+int growBag(EpochBag* bag) {
+	int capacity = bag->capacity == 0 ? EPOCH_BAG_SIZE : bag->capacity * 2;
+	kmem_cache_t** caches = krealloc(bag->caches, capacity * sizeof(kmem_cache_t*));
+	if (caches == NULL) return 0; //nema prostora
+	bag->caches = caches;
+
+	void** objects = krealloc(bag->objects, capacity * sizeof(void*));
+	if (objects == NULL) return 0; //nema prostora
+	bag->objects = objects;
+	bag->capacity = capacity;
+	return 1;
+}
+
+int kmem_cache_free_deferred(kmem_cache_t* cachep, void* objp)
+{
+	if (cachep == NULL || objp == NULL) return -1; //neispravan argument
+
+	EpochThread* record = getEpochThread();
+	if (record == NULL) return -1; //sva mesta za niti su zauzeta
+
+	LONG epoch = currentEpoch(); //cita se posle izbacivanja objekta iz strukture
+	EpochBag* bag = &record->bags[epoch % EPOCH_BAGS];
+	if (bag->epoch != epoch) {
+		reclaimBag(bag); //na istoj poziciji je bila epoha bar EPOCH_BAGS starija, grace period je prosao
+		bag->epoch = epoch;
+	}
+	if (bag->count == bag->capacity && !growBag(bag)) return -1; //nema mesta za evidenciju, objekat ostaje zauzet
+
+	bag->caches[bag->count] = cachep;
+	bag->objects[bag->count++] = objp;
+
+	if (bag->count % EPOCH_ADVANCE_BATCH == 0) {
+		tryAdvanceEpoch();
+		reclaimExpired(record);
+	}
+	return 0;
+}
+
+void kmem_epoch_barrier()
+{
+	if (epochSlot < 0) return; //nit nije koristila epohe
+
+	EpochThread* record = &epochThreads[epochSlot];
+	if (record->nesting > 0) return; //nit je u sekciji citanja, grace period ne bi prosao
+
+	LONG target = currentEpoch() + 2;
+	while (currentEpoch() - target < 0) {
+		tryAdvanceEpoch();
+		if (currentEpoch() - target < 0)
+			SwitchToThread();
+	}
+
+	for (int i = 0; i < EPOCH_BAGS; i++) {
+		EpochBag* bag = &record->bags[i];
+		reclaimBag(bag);
+		kfree(bag->caches);
+		kfree(bag->objects);
+		bag->caches = NULL;
+		bag->objects = NULL;
+		bag->capacity = 0;
+		bag->epoch = 0;
+	}
+	epochSlot = -1;
+	InterlockedExchange(&record->owner, 0); //mesto se oslobadja za druge niti
+}
@@ -0,0 +1,15 @@
+#pragma once
+// File: epoch.h
+#include "slab.h"
+
+#define EPOCH_MAX_THREADS 64
+#define EPOCH_BAGS 3
+#define EPOCH_BAG_SIZE 64
+#define EPOCH_ADVANCE_BATCH 32
+//objekat odlozen u epohi e se vraca kesu tek kada globalna epoha dostigne e + 2,
+//jer tada nijedna nit vise nije u sekciji citanja zapocetoj pre njegovog izbacivanja iz strukture
+
+int kmem_epoch_enter(); // Enter read-side section (nests), returns 0 if there is no free thread slot
+void kmem_epoch_exit(); // Leave read-side section
+int kmem_cache_free_deferred(kmem_cache_t* cachep, void* objp); // Free object after all current readers leave, returns -1 if it cannot be recorded
+void kmem_epoch_barrier(); // Wait for a grace period and free everything this thread deferred; call before the thread exits
@@ -0,0 +1,60 @@
+#include "lock.h"
+
+LONG64 lockOwnerId() {
+	return ((LONG64) GetCurrentProcessId() << 32) | GetCurrentThreadId();
+}
+
+void lock_init(KmemLock* lock, int shared) {
+	lock->shared = shared;
+	lock->state = lock->destroyed = 0;
+	lock->owner = 0;
+	lock->recursion = 0;
+	lock->mutex = shared ? NULL : CreateMutex(NULL, FALSE, NULL);
+}
+
+int lock_acquire(KmemLock* lock) {
+	if (!lock->shared)
+		return WaitForSingleObject(lock->mutex, INFINITE) == WAIT_OBJECT_0;
+
+	LONG64 self = lockOwnerId();
+	if (lock->owner == self) {
+		++(lock->recursion);
+		return 1;
+	}
+
+	int spins = 0;
+	while (InterlockedCompareExchange(&lock->state, 1, 0) != 0) {
+		if (lock->destroyed) return 0;
+		if (++spins == LOCK_SPIN_COUNT) {
+			spins = 0;
+			SwitchToThread();
+		}
+	}
+	if (lock->destroyed) {
+		InterlockedExchange(&lock->state, 0);
+		return 0; //unistena dok se cekalo
+	}
+	lock->owner = self;
+	lock->recursion = 1;
+	return 1;
+}
+
+void lock_release(KmemLock* lock) {
+	if (!lock->shared) {
+		ReleaseMutex(lock->mutex);
+		return;
+	}
+
+	if (--(lock->recursion) == 0) {
+		lock->owner = 0;
+		InterlockedExchange(&lock->state, 0);
+	}
+}
+
+void lock_destroy(KmemLock* lock) {
+	if (!lock->shared) {
+		CloseHandle(lock->mutex);
+		return;
+	}
+	lock->destroyed = 1; //brava ostaje zauzeta, svi koji cekaju odustaju
+}
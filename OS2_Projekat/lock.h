@@ -0,0 +1,21 @@
+#pragma once
+// File: lock.h
+#include <windows.h>
+
+#define LOCK_SPIN_COUNT 1000
+
+//rekurzivna brava; u deljenom rezimu je cela u memoriji arene, pa radi izmedju procesa
+typedef struct kmem_lock {
+	HANDLE mutex; //obican rezim, vazi samo u procesu koji je napravio bravu
+	volatile LONG state, destroyed;
+	volatile LONG64 owner; //(id procesa << 32) | id niti
+	int recursion, shared;
+} KmemLock;
+
+void lock_init(KmemLock* lock, int shared);
+
+int lock_acquire(KmemLock* lock); //vraca 0 ako je brava unistena
+
+void lock_release(KmemLock* lock);
+
+void lock_destroy(KmemLock* lock);
@@ -3,13 +3,20 @@
 #include <string.h>
 #include <assert.h>
 #include "slab.h"
+#include "slab_structs.h"
 #include "test.h"
+#include "trace.h"
+#include "replay.h"
+#include "region.h"
+#include "epoch.h"
+#include <windows.h>
 
 #define BLOCK_NUMBER (1000)
 #define THREAD_NUM (5)
 #define ITERATIONS (1000)
 
 #define shared_size (7)
+#define COMPACT_OBJECTS ((int)(8 * BLOCK_SIZE / sizeof(struct movable_s))) //objekti za nekoliko ploca pri svakoj velicini bloka
 
 
 void construct(void *data) {
@@ -69,9 +76,256 @@ void work(void* pdata) {
 	kmem_cache_destroy(cache);
 }
 
-int main() {
+struct movable_s {
+	int id;
+	struct movable_s **owner;
+};
+
+int move_object(void *from, void *to) {
+	struct movable_s *object = (struct movable_s *)to;
+	*object->owner = object;
+	return 1;
+}
+
+int run_compact() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init(space, BLOCK_NUMBER);
+	kmem_cache_t *cache = kmem_cache_create("movable object", sizeof(struct movable_s), NULL, NULL);
+	struct movable_s **objects = (struct movable_s **)malloc(sizeof(struct movable_s *) * COMPACT_OBJECTS);
+	for (int i = 0; i < COMPACT_OBJECTS; i++) {
+		objects[i] = (struct movable_s *)kmem_cache_alloc(cache);
+		objects[i]->id = i;
+		objects[i]->owner = &objects[i];
+	}
+	for (int i = 0; i < COMPACT_OBJECTS; i++) {
+		if (i % 10 != 0) {
+			kmem_cache_free(cache, objects[i]);
+			objects[i] = NULL;
+		}
+	}
+	kmem_cache_info(cache);
+
+	int refused = kmem_cache_compact(cache);
+	assert(refused == 0); //bez move sazimanje nije dozvoljeno
+	kmem_cache_set_move(cache, move_object);
+	int blocksFreed = kmem_cache_compact(cache);
+	assert(blocksFreed > 0);
+	kmem_cache_info(cache);
+
+	for (int i = 0; i < COMPACT_OBJECTS; i++) {
+		if (objects[i] == NULL) continue;
+		assert(objects[i]->id == i && objects[i]->owner == &objects[i]);
+		kmem_cache_free(cache, objects[i]);
+		assert(kmem_cache_error(cache) == 0);
+	}
+	kmem_cache_destroy(cache);
+	printf_s("Compaction released %d blocks.\n", blocksFreed);
+
+	free(objects);
+	free(space);
+	return 0;
+}
+
+struct node_s {
+	int id;
+	int check;
+};
+
+struct node_s *volatile published = NULL;
+
+//nit 1 zamenjuje objavljeni cvor i odlaze oslobadjanje starog, ostale niti ga citaju u sekciji citanja
+void epoch_work(void *pdata) {
+	struct data_s data = *(struct data_s *)pdata;
+	for (int i = 0; i < data.iterations * 10; i++) {
+		if (data.id == 1) {
+			struct node_s *node = (struct node_s *)kmem_cache_alloc(data.shared);
+			node->id = i;
+			node->check = ~i;
+			struct node_s *old = (struct node_s *)InterlockedExchangePointer((PVOID volatile *)&published, node);
+			if (old != NULL && kmem_cache_free_deferred(data.shared, old) != 0)
+				kmem_cache_free(data.shared, old); //nema mesta za evidenciju, citaoci su zavrsili pre kraja programa
+		}
+		else {
+			int entered = kmem_epoch_enter();
+			assert(entered);
+			volatile struct node_s *node = published;
+			if (node != NULL) {
+				int id = node->id;
+				SwitchToThread(); //pisac stize da zameni cvor dok ga citalac drzi
+				assert(node->id == id && node->check == ~id); //oslobodjen cvor bi bio prepisan vezom slobodne liste
+			}
+			kmem_epoch_exit();
+		}
+	}
+	kmem_epoch_barrier();
+}
+
+int run_epoch() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init(space, BLOCK_NUMBER);
+	kmem_cache_t *cache = kmem_cache_create("epoch node", sizeof(struct node_s), NULL, NULL);
+	struct data_s data;
+	data.shared = cache;
+	data.iterations = ITERATIONS;
+	run_threads(epoch_work, &data, THREAD_NUM);
+
+	kmem_cache_free(cache, published);
+	kmem_cache_info(cache);
+	kmem_cache_destroy(cache);
+	assert(kmem_cache_find("epoch node") == NULL); //svi odlozeni cvorovi su vraceni, pa je kes unisten
+	printf_s("Deferred frees reclaimed.\n");
+
+	free(space);
+	return 0;
+}
+
+int run_region() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init(space, BLOCK_NUMBER);
+	kmem_region_t *region = kmem_region_create(0);
+	assert(region != NULL);
+	void *overflow = kmem_region_alloc(region, (size_t)-1, 0);
+	assert(overflow == NULL); //velicina koja prekoracuje size_t se odbija
+
+	for (int round = 0; round < 3; round++) {
+		unsigned char *objects[ITERATIONS];
+		for (int i = 0; i < ITERATIONS; i++) {
+			size_t align = (size_t)1 << (i % 7);
+			objects[i] = (unsigned char *)kmem_region_alloc(region, i % 100 + 1, align);
+			assert(objects[i] != NULL && (size_t)objects[i] % align == 0);
+			memset(objects[i], MASK, i % 100 + 1);
+		}
+		for (int i = 0; i < ITERATIONS; i++)
+			assert(check(objects[i], i % 100 + 1));
+		kmem_region_reset(region);
+	}
+	void *large = kmem_region_alloc(region, 64 * BLOCK_SIZE, 0); //vece od chunka regiona
+	assert(large != NULL);
+	memset(large, MASK, 64 * BLOCK_SIZE);
+	kmem_region_destroy(region);
+	printf_s("Region allocated and reset.\n");
+
+	free(space);
+	return 0;
+}
+
+//drugi proces se oponasa kopijom arene na drugoj adresi
+int run_shared() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init_shared(space, BLOCK_NUMBER);
+	kmem_cache_t *refusedCache = kmem_cache_create("shared ctor", shared_size, construct, NULL);
+	assert(refusedCache == NULL); //konstruktor nije validan u drugom procesu
+
+	kmem_cache_t *cache = kmem_cache_create("shared object", shared_size, NULL, NULL);
+	int reserved = kmem_cache_reserve(cache, ITERATIONS);
+	assert(reserved == 0); //nit za dopunu ne bi postojala u drugom procesu
+	size_t offsets[ITERATIONS];
+	for (int i = 0; i < ITERATIONS; i++) {
+		void *data = kmem_cache_alloc(cache);
+		memset(data, MASK, shared_size);
+		offsets[i] = kmem_offset(data);
+	}
+
+	void *mapping = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	memcpy(mapping, space, BLOCK_SIZE * BLOCK_NUMBER);
+	int attached = kmem_attach(mapping);
+	assert(attached);
+	cache = kmem_cache_find("shared object");
+	assert(cache != NULL);
+	for (int i = 0; i < ITERATIONS; i++) {
+		assert(check(kmem_pointer(offsets[i]), shared_size));
+		kmem_cache_free(cache, kmem_pointer(offsets[i]));
+	}
+	kmem_cache_info(cache);
+	kmem_cache_destroy(cache);
+	printf_s("Shared arena attached at another address.\n");
+
+	free(mapping);
+	free(space);
+	return 0;
+}
+
+//dva kesa iste velicine dele ploce, ali svaki objekat pripada kesu koji ga je alocirao
+int run_merge() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init(space, BLOCK_NUMBER);
+	kmem_cache_set_merging(1);
+	kmem_cache_t *first = kmem_cache_create("merged first", shared_size, NULL, NULL);
+	kmem_cache_t *second = kmem_cache_create("merged second", shared_size, NULL, NULL);
+	assert(first != NULL && second != NULL);
+
+	void *data = kmem_cache_alloc(first);
+	memset(data, MASK, shared_size);
+	kmem_cache_free(second, data);
+	assert(kmem_cache_error(second) == ERRCODE_INVALID_OBJECT); //objekat drugog kesa iz skupa se ne oslobadja
+	assert(check(data, shared_size));
+
+	kmem_cache_destroy(first);
+	assert(kmem_cache_error(first) == ERRCODE_CACHE_NOT_EMPTY); //kes koji drzi objekat u skupu se ne unistava
+	kmem_cache_info(first);
+
+	kmem_cache_free(first, data);
+	assert(kmem_cache_error(first) == 0);
+	kmem_cache_destroy(first);
+	kmem_cache_destroy(second);
+	assert(kmem_cache_find("merged first") == NULL && kmem_cache_find("merged second") == NULL);
+	printf_s("Merged caches kept their objects apart.\n");
+
+	free(space);
+	return 0;
+}
+
+//alokacije preko rezerve prave ploce sinhrono, kes se unistava dok pozadinska nit jos dopunjuje
+int run_reserve() {
+	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
+	kmem_init(space, BLOCK_NUMBER);
+	kmem_cache_t *cache = kmem_cache_create("reserved object", shared_size, NULL, NULL);
+	int reserved = kmem_cache_reserve(cache, ITERATIONS);
+	assert(reserved >= ITERATIONS);
+	kmem_cache_info(cache);
+
+	void **objects = (void **)malloc(sizeof(void *) * ITERATIONS * 10);
+	for (int i = 0; i < ITERATIONS * 10; i++) {
+		objects[i] = kmem_cache_alloc(cache);
+		assert(objects[i] != NULL);
+		memset(objects[i], MASK, shared_size);
+	}
+	kmem_cache_info(cache); //alokacije mimo rezerve se vide u izvestaju
+	for (int i = 0; i < ITERATIONS * 10; i++) {
+		assert(check(objects[i], shared_size));
+		kmem_cache_free(cache, objects[i]);
+	}
+	assert(kmem_cache_error(cache) == 0);
+
+	kmem_cache_destroy(cache); //dopuna je i dalje zatrazena
+	assert(kmem_cache_find("reserved object") == NULL);
+	printf_s("Reserved cache destroyed during refill.\n");
+
+	free(objects);
+	free(space);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc >= 3 && !strcmp(argv[1], "replay"))
+		return kmem_trace_replay(argv[2], argc >= 4 ? atoi(argv[3]) : 1, BLOCK_NUMBER);
+	if (argc >= 2 && !strcmp(argv[1], "shared"))
+		return run_shared();
+	if (argc >= 2 && !strcmp(argv[1], "compact"))
+		return run_compact();
+	if (argc >= 2 && !strcmp(argv[1], "region"))
+		return run_region();
+	if (argc >= 2 && !strcmp(argv[1], "epoch"))
+		return run_epoch();
+	if (argc >= 2 && !strcmp(argv[1], "merge"))
+		return run_merge();
+	if (argc >= 2 && !strcmp(argv[1], "reserve"))
+		return run_reserve();
+
 	void *space = malloc(BLOCK_SIZE * BLOCK_NUMBER);
 	kmem_init(space, BLOCK_NUMBER);
+	if (argc >= 3 && !strcmp(argv[1], "trace"))
+		kmem_trace_start(argv[2]);
 	//while (1) {
 		kmem_cache_t *shared = kmem_cache_create("shared object", shared_size, construct, NULL);
 		struct data_s data;
@@ -80,6 +334,7 @@ int main() {
 		run_threads(work, &data, THREAD_NUM);
 		kmem_cache_destroy(shared);
 	//}
+	kmem_trace_stop();
 	free(space);
 	return 0;
 }
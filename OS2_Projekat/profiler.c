@@ -0,0 +1,247 @@
+#include "profiler.h"
+#include "slab_structs.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <windows.h>
+
+typedef struct profile_site {
+	char cacheName[MAX_NAME_LENGTH];
+	void* stack[PROFILE_MAX_DEPTH];
+	int depth;
+	unsigned long hash;
+	size_t liveCount, liveBytes, allocCount, allocBytes;
+} ProfileSite;
+
+typedef struct profile_sample {
+	const void* object;
+	size_t size;
+	int site, next;
+} ProfileSample;
+
+volatile int profilerActive = 0;
+volatile long profilerLiveSamples = 0;
+volatile LONG profilerInitState = 0; //0 - nije inicijalizovan, 1 - inicijalizacija u toku, 2 - inicijalizovan
+
+size_t sampleInterval = PROFILE_DEFAULT_INTERVAL;
+int profileGeneration = 0, numberOfSites = 0, freeSample = -1, droppedSamples = 0;
+HANDLE profilerMutex = NULL;
+
+ProfileSite profileSites[PROFILE_MAX_SITES];
+ProfileSample profileSamples[PROFILE_MAX_SAMPLES];
+int sampleBuckets[PROFILE_HASH_SIZE];
+
+//stanje svake niti, brzi put je samo umanjivanje brojaca
+__declspec(thread) long long bytesUntilSample = 0;
+__declspec(thread) int threadGeneration = 0;
+__declspec(thread) unsigned long long randomState = 0;
+
+long long nextSampleInterval() {
+	if (randomState == 0)
+		randomState = ((unsigned long long) GetCurrentThreadId() << 32) ^ (size_t) &randomState ^ 0x9E3779B97F4A7C15ULL;
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+
+	//u je uniformno iz (0,1], razmak do sledeceg uzorka je eksponencijalno raspodeljen sa srednjom vrednoscu sampleInterval
+	double u = ((randomState >> 11) + 1) * (1.0 / 9007199254740992.0);
+	return (long long)(-log(u) * sampleInterval) + 1;
+}
+
+void kmem_profile_start(size_t sample_interval)
+{
+	if (InterlockedCompareExchange(&profilerInitState, 1, 0) == 0) { //tabele inicijalizuje samo prva nit
+		for (int i = 0; i < PROFILE_HASH_SIZE; sampleBuckets[i++] = -1);
+		for (int i = 0; i < PROFILE_MAX_SAMPLES; i++)
+			profileSamples[i].next = i + 1 < PROFILE_MAX_SAMPLES ? i + 1 : -1;
+		freeSample = 0;
+		profilerMutex = CreateMutex(NULL, FALSE, NULL);
+		InterlockedExchange(&profilerInitState, 2);
+	}
+	while (InterlockedCompareExchange(&profilerInitState, 2, 2) != 2) SwitchToThread(); //ostale niti cekaju kraj inicijalizacije
+
+	WaitForSingleObject(profilerMutex, INFINITE);
+	sampleInterval = sample_interval > 0 ? sample_interval : PROFILE_DEFAULT_INTERVAL;
+	++profileGeneration; //niti ce izvuci nov razmak po novom intervalu
+	profilerActive = 1;
+	ReleaseMutex(profilerMutex);
+}
+
+void kmem_profile_stop()
+{
+	profilerActive = 0;
+}
+
+int findSite(const char* cacheName, void** stack, int depth, unsigned long hash) {
+	for (int i = 0; i < numberOfSites; i++) {
+		ProfileSite* site = &profileSites[i];
+		if (site->hash == hash && site->depth == depth && !strcmp(site->cacheName, cacheName)
+			&& !memcmp(site->stack, stack, depth * sizeof(void*)))
+			return i;
+	}
+	if (numberOfSites == PROFILE_MAX_SITES) return -1; //nema mesta za novo mesto poziva
+
+	ProfileSite* site = &profileSites[numberOfSites];
+	strcpy_s(site->cacheName, MAX_NAME_LENGTH, cacheName);
+	memcpy(site->stack, stack, depth * sizeof(void*));
+	site->depth = depth;
+	site->hash = hash;
+	site->liveCount = site->liveBytes = site->allocCount = site->allocBytes = 0;
+	return numberOfSites++;
+}
+
+void profiler_alloc(const char* cacheName, void* objp, size_t size)
+{
+	if (threadGeneration != profileGeneration) {
+		threadGeneration = profileGeneration;
+		bytesUntilSample = nextSampleInterval();
+	}
+	bytesUntilSample -= size;
+	if (bytesUntilSample > 0) return;
+	bytesUntilSample = nextSampleInterval();
+
+	void* stack[PROFILE_MAX_DEPTH];
+	ULONG hash = 0;
+	int depth = CaptureStackBackTrace(1, PROFILE_MAX_DEPTH, stack, &hash);
+
+	WaitForSingleObject(profilerMutex, INFINITE);
+	int siteIndex = findSite(cacheName, stack, depth, hash);
+	if (siteIndex < 0 || freeSample < 0) {
+		++droppedSamples;
+		ReleaseMutex(profilerMutex); //tabele su pune
+		return;
+	}
+
+	ProfileSite* site = &profileSites[siteIndex];
+	++(site->liveCount);
+	site->liveBytes += size;
+	++(site->allocCount);
+	site->allocBytes += size;
+
+	int sampleIndex = freeSample;
+	ProfileSample* sample = &profileSamples[sampleIndex];
+	freeSample = sample->next;
+	int bucket = ((size_t) objp >> 4) % PROFILE_HASH_SIZE;
+	sample->object = objp;
+	sample->size = size;
+	sample->site = siteIndex;
+	sample->next = sampleBuckets[bucket];
+	sampleBuckets[bucket] = sampleIndex;
+	InterlockedIncrement(&profilerLiveSamples);
+	ReleaseMutex(profilerMutex);
+}
+
+void profiler_free(const void* objp)
+{
+	WaitForSingleObject(profilerMutex, INFINITE);
+	int* link = &sampleBuckets[((size_t) objp >> 4) % PROFILE_HASH_SIZE];
+	while (*link != -1 && profileSamples[*link].object != objp)
+		link = &profileSamples[*link].next;
+
+	if (*link != -1) {
+		int sampleIndex = *link;
+		ProfileSample* sample = &profileSamples[sampleIndex];
+		ProfileSite* site = &profileSites[sample->site];
+		--(site->liveCount);
+		site->liveBytes -= sample->size;
+
+		*link = sample->next;
+		sample->object = NULL;
+		sample->next = freeSample;
+		freeSample = sampleIndex;
+		InterlockedDecrement(&profilerLiveSamples);
+	}
+	ReleaseMutex(profilerMutex);
+}
+
+//uzorak premestenog objekta ostaje zivi, samo se vezuje za novu adresu
+void profiler_move(const void* from, void* to)
+{
+	WaitForSingleObject(profilerMutex, INFINITE);
+	int* link = &sampleBuckets[((size_t) from >> 4) % PROFILE_HASH_SIZE];
+	while (*link != -1 && profileSamples[*link].object != from)
+		link = &profileSamples[*link].next;
+
+	if (*link != -1) {
+		int sampleIndex = *link;
+		ProfileSample* sample = &profileSamples[sampleIndex];
+		*link = sample->next;
+
+		int bucket = ((size_t) to >> 4) % PROFILE_HASH_SIZE;
+		sample->object = to;
+		sample->next = sampleBuckets[bucket];
+		sampleBuckets[bucket] = sampleIndex;
+	}
+	ReleaseMutex(profilerMutex);
+}
+
+//bafer prosiren u mestu zadrzava uzorak, menja se samo njegova velicina
+void profiler_resize(const void* objp, size_t size)
+{
+	WaitForSingleObject(profilerMutex, INFINITE);
+	int sampleIndex = sampleBuckets[((size_t) objp >> 4) % PROFILE_HASH_SIZE];
+	while (sampleIndex != -1 && profileSamples[sampleIndex].object != objp)
+		sampleIndex = profileSamples[sampleIndex].next;
+
+	if (sampleIndex != -1) {
+		ProfileSample* sample = &profileSamples[sampleIndex];
+		ProfileSite* site = &profileSites[sample->site];
+		site->liveBytes += size - sample->size;
+		sample->size = size;
+	}
+	ReleaseMutex(profilerMutex);
+}
+
+int kmem_profile_dump(const char* fileName)
+{
+	FILE* file;
+	if (profilerInitState != 2 || fileName == NULL) return -1; //profajler nije pokretan
+	if (fopen_s(&file, fileName, "w") != 0) return -1;
+
+	WaitForSingleObject(profilerMutex, INFINITE);
+	size_t liveCount = 0, liveBytes = 0, allocCount = 0, allocBytes = 0;
+	for (int i = 0; i < numberOfSites; i++) {
+		liveCount += profileSites[i].liveCount;
+		liveBytes += profileSites[i].liveBytes;
+		allocCount += profileSites[i].allocCount;
+		allocBytes += profileSites[i].allocBytes;
+	}
+
+	//heap_v2 zaglavlje, pprof sam skalira uzorkovane vrednosti prema intervalu
+	fprintf(file, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n", liveCount, liveBytes, allocCount, allocBytes, sampleInterval);
+	for (int i = 0; i < numberOfSites; i++) {
+		ProfileSite* site = &profileSites[i];
+		fprintf(file, "%zu: %zu [%zu: %zu] @", site->liveCount, site->liveBytes, site->allocCount, site->allocBytes);
+		for (int j = 0; j < site->depth; j++)
+			fprintf(file, " 0x%llx", (unsigned long long)(size_t) site->stack[j]);
+		fputc('\n', file);
+	}
+	ReleaseMutex(profilerMutex);
+
+	fclose(file);
+	return 0;
+}
+
+void kmem_profile_info()
+{
+	if (profilerInitState != 2) {
+		printf("Profajler nije pokretan\n");
+		return;
+	}
+
+	WaitForSingleObject(profilerMutex, INFINITE);
+	printf("----PROFIL ZIVE MEMORIJE (interval %zu B)----\n", sampleInterval);
+	for (int i = 0; i < numberOfSites; i++) {
+		ProfileSite* site = &profileSites[i];
+		if (site->liveCount == 0) continue;
+		printf("Kes: %s ; Zivih uzoraka: %zu (%zu B) ; Ukupno uzoraka: %zu (%zu B) ; Mesto poziva:", site->cacheName,
+			site->liveCount, site->liveBytes, site->allocCount, site->allocBytes);
+		for (int j = 0; j < site->depth; j++)
+			printf(" 0x%llx", (unsigned long long)(size_t) site->stack[j]);
+		putchar('\n');
+	}
+	if (droppedSamples > 0)
+		printf("Odbaceno uzoraka: %d\n", droppedSamples);
+	printf("--------\n");
+	ReleaseMutex(profilerMutex);
+}
@@ -0,0 +1,22 @@
+#pragma once
+// File: profiler.h
+#include "slab.h"
+
+#define PROFILE_MAX_DEPTH 16
+#define PROFILE_MAX_SITES 512
+#define PROFILE_MAX_SAMPLES 4096
+#define PROFILE_HASH_SIZE 1024
+#define PROFILE_DEFAULT_INTERVAL (512 * 1024)
+
+extern volatile int profilerActive;
+extern volatile long profilerLiveSamples;
+
+void kmem_profile_start(size_t sample_interval); // Start sampling roughly one allocation per sample_interval bytes
+void kmem_profile_stop(); // Stop sampling (already sampled objects are still tracked)
+int kmem_profile_dump(const char* fileName); // Write live heap profile per call site (pprof heap_v2 text format)
+void kmem_profile_info(); // Print live heap profile per call site
+
+void profiler_alloc(const char* cacheName, void* objp, size_t size);
+void profiler_free(const void* objp);
+void profiler_move(const void* from, void* to);
+void profiler_resize(const void* objp, size_t size);
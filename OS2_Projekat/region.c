@@ -0,0 +1,101 @@
+#include "region.h"
+#include "buddy.h"
+#include <stdint.h>
+
+struct region_chunk {
+	struct region_chunk* next;
+	size_t size;
+};
+
+struct kmem_region {
+	RegionChunk* chunks; //tekuci chunk je prvi u listi
+	RegionChunk* freeChunks; //skoro korisceni chunkovi, cuvaju se izmedju resetovanja
+	int freeCount;
+	char* current, * end;
+	size_t chunkSize;
+};
+
+kmem_region_t* kmem_region_create(size_t chunk_size)
+{
+	kmem_region_t* region = kmalloc(sizeof(kmem_region_t));
+	if (region == NULL) return NULL; //nema prostora ili alokator nije inicijalizovan
+
+	region->chunks = region->freeChunks = NULL;
+	region->freeCount = 0;
+	region->current = region->end = NULL;
+	region->chunkSize = buddy_chunk_size(chunk_size != 0 ? chunk_size : REGION_DEFAULT_CHUNK); //ceo buddy chunk je upotrebljiv
+	return region;
+}
+
+RegionChunk* getRegionChunk(kmem_region_t* region, size_t spaceNeeded) {
+	RegionChunk* chunk;
+	if (spaceNeeded <= region->chunkSize && region->freeChunks != NULL) {
+		chunk = region->freeChunks; //bez brave alokatora
+		region->freeChunks = chunk->next;
+		--(region->freeCount);
+	}
+	else {
+		size_t size = spaceNeeded <= region->chunkSize ? region->chunkSize : buddy_chunk_size(spaceNeeded);
+		chunk = kmem_chunk_take(size);
+		if (chunk == NULL) return NULL; //nema prostora
+		chunk->size = size;
+	}
+
+	chunk->next = region->chunks;
+	region->chunks = chunk;
+	region->current = (char*) chunk + sizeof(RegionChunk);
+	region->end = (char*) chunk + chunk->size;
+	return chunk;
+}
+
+void* kmem_region_alloc(kmem_region_t* region, size_t size, size_t align)
+{
+	if (region == NULL || size == 0) return NULL; //neispravan argument
+	if (align == 0) align = sizeof(void*);
+	if (align & (align - 1)) return NULL; //poravnanje mora biti stepen dvojke
+	if (size > SIZE_MAX - sizeof(RegionChunk) - align) return NULL; //potreban chunk bi prekoracio size_t
+
+	char* objp = (char*)(((size_t) region->current + align - 1) & ~(align - 1));
+	if (region->current == NULL || objp > region->end || size > (size_t)(region->end - objp)) {
+		//ostatak tekuceg chunka se ne koristi do resetovanja
+		if (getRegionChunk(region, sizeof(RegionChunk) + size + align - 1) == NULL) return NULL;
+		objp = (char*)(((size_t) region->current + align - 1) & ~(align - 1));
+		if (objp > region->end || size > (size_t)(region->end - objp)) return NULL; //chunk ipak nije dovoljno veliki
+	}
+
+	region->current = objp + size;
+	return objp;
+}
+
+void kmem_region_reset(kmem_region_t* region)
+{
+	if (region == NULL) return; //neispravan argument
+
+	RegionChunk* chunk = region->chunks;
+	while (chunk != NULL) {
+		RegionChunk* next = chunk->next;
+		if (chunk->size == region->chunkSize && region->freeCount < REGION_MAX_FREE_CHUNKS) {
+			chunk->next = region->freeChunks;
+			region->freeChunks = chunk;
+			++(region->freeCount);
+		}
+		else kmem_chunk_give(chunk, chunk->size); //veliki chunkovi i visak se vracaju buddy alokatoru
+		chunk = next;
+	}
+	region->chunks = NULL;
+	region->current = region->end = NULL;
+}
+
+void kmem_region_destroy(kmem_region_t* region)
+{
+	if (region == NULL) return; //neispravan argument
+
+	kmem_region_reset(region);
+	RegionChunk* chunk = region->freeChunks;
+	while (chunk != NULL) {
+		RegionChunk* next = chunk->next;
+		kmem_chunk_give(chunk, chunk->size);
+		chunk = next;
+	}
+	kfree(region);
+}
@@ -0,0 +1,17 @@
+#pragma once
+// File: region.h
+#include "slab.h"
+
+#define REGION_DEFAULT_CHUNK (16 * BLOCK_SIZE)
+#define REGION_MAX_FREE_CHUNKS 8
+//region koristi jedna nit i nije zasticen bravom; chunkovi se uzimaju direktno od buddy alokatora,
+//a posle resetovanja do REGION_MAX_FREE_CHUNKS chunkova ostaje regionu, pa ustaljen rad ne uzima bravu alokatora
+
+typedef struct region_chunk RegionChunk;
+
+typedef struct kmem_region kmem_region_t;
+
+kmem_region_t* kmem_region_create(size_t chunk_size); // Create region taking chunk_size chunks (0 for default)
+void* kmem_region_alloc(kmem_region_t* region, size_t size, size_t align); // Allocate from region, align is a power of two (0 for pointer size)
+void kmem_region_reset(kmem_region_t* region); // Release everything allocated from region, keeping recently used chunks
+void kmem_region_destroy(kmem_region_t* region); // Release region and all its chunks
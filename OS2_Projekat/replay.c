@@ -0,0 +1,325 @@
+#include "replay.h"
+#include "buddy.h"
+#include "slab_structs.h"
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+typedef struct replay_event {
+	TraceRecord record;
+	char name[MAX_NAME_LENGTH];
+	int cacheEvent, objectEvent; //indeks dogadjaja koji je napravio kes/objekat, -1 ako ga nema u tragu
+	int worker;
+} ReplayEvent;
+
+typedef struct replay_map_node {
+	unsigned long long key;
+	int event, next;
+} ReplayMapNode;
+
+typedef struct replay_map {
+	int* buckets;
+	ReplayMapNode* nodes;
+	int bucketCount, nodeCount;
+} ReplayMap;
+
+typedef struct replay_sample {
+	long eventsDone;
+	double seconds;
+	BuddyStats stats;
+} ReplaySample;
+
+typedef struct replay_worker {
+	int* events;
+	int count;
+} ReplayWorker;
+
+ReplayEvent* replayEvents = NULL;
+void* volatile* replayResults = NULL;
+volatile LONG* replayDone = NULL;
+volatile LONG replayProgress = 0, replayWatermark = 0;
+ReplaySample* replaySamples = NULL;
+LARGE_INTEGER replayStart, replayFrequency;
+
+void mapInit(ReplayMap* map, int capacity) {
+	map->bucketCount = 1;
+	while (map->bucketCount < capacity) map->bucketCount <<= 1;
+	map->buckets = malloc(sizeof(int) * map->bucketCount);
+	map->nodes = malloc(sizeof(ReplayMapNode) * (capacity > 0 ? capacity : 1));
+	map->nodeCount = 0;
+	for (int i = 0; i < map->bucketCount; map->buckets[i++] = -1);
+}
+
+void mapFree(ReplayMap* map) {
+	free(map->buckets);
+	free(map->nodes);
+}
+
+int mapBucket(ReplayMap* map, unsigned long long key) {
+	key ^= key >> 29;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 32;
+	return (int)(key & (map->bucketCount - 1));
+}
+
+void mapPut(ReplayMap* map, unsigned long long key, int event) {
+	int bucket = mapBucket(map, key);
+	ReplayMapNode* node = &map->nodes[map->nodeCount];
+	node->key = key;
+	node->event = event;
+	node->next = map->buckets[bucket];
+	map->buckets[bucket] = map->nodeCount++;
+}
+
+int mapGet(ReplayMap* map, unsigned long long key, int remove) {
+	int* link = &map->buckets[mapBucket(map, key)];
+	while (*link != -1 && map->nodes[*link].key != key)
+		link = &map->nodes[*link].next;
+	if (*link == -1) return -1; //adresa nije nastala u snimljenom delu traga
+
+	int event = map->nodes[*link].event;
+	if (remove) *link = map->nodes[*link].next;
+	return event;
+}
+
+int loadTrace(const char* fileName, int* numEvents) {
+	FILE* file;
+	TraceHeader header;
+	if (fopen_s(&file, fileName, "rb") != 0) return -1;
+	if (fread(&header, sizeof(TraceHeader), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, 4) || header.version != TRACE_VERSION) {
+		fclose(file);
+		return -1; //nije fajl traga
+	}
+
+	int capacity = 1024, count = 0;
+	replayEvents = malloc(sizeof(ReplayEvent) * capacity);
+	TraceRecord record;
+	while (fread(&record, sizeof(TraceRecord), 1, file) == 1) {
+		if (count == capacity) {
+			capacity <<= 1;
+			replayEvents = realloc(replayEvents, sizeof(ReplayEvent) * capacity);
+		}
+		ReplayEvent* event = &replayEvents[count++];
+		event->record = record;
+		event->name[0] = 0;
+		if (record.type == TRACE_CACHE_CREATE && fread(event->name, MAX_NAME_LENGTH, 1, file) != 1) {
+			--count;
+			break; //trag je presecen
+		}
+		event->name[MAX_NAME_LENGTH - 1] = 0;
+	}
+	fclose(file);
+	*numEvents = count;
+	return 0;
+}
+
+//svaki dogadjaj pamti indeks dogadjaja od kog zavisi, pa niti mogu nezavisno da ga cekaju
+void resolveTrace(int numEvents, int numThreads) {
+	ReplayMap caches, objects;
+	unsigned int threadIds[REPLAY_MAX_THREADS];
+	int distinctThreads = 0;
+	mapInit(&caches, numEvents);
+	mapInit(&objects, numEvents);
+
+	for (int i = 0; i < numEvents; i++) {
+		ReplayEvent* event = &replayEvents[i];
+		TraceRecord* record = &event->record;
+		event->cacheEvent = event->objectEvent = -1;
+
+		switch (record->type) {
+		case TRACE_CACHE_CREATE:
+			mapPut(&caches, record->cache, i);
+			break;
+		case TRACE_CACHE_ALLOC:
+			event->cacheEvent = mapGet(&caches, record->cache, 0);
+			if (record->object) mapPut(&objects, record->object, i);
+			break;
+		case TRACE_KMALLOC:
+			if (record->object) mapPut(&objects, record->object, i);
+			break;
+		case TRACE_CACHE_FREE:
+			event->cacheEvent = mapGet(&caches, record->cache, 0);
+			event->objectEvent = mapGet(&objects, record->object, 1);
+			break;
+		case TRACE_KFREE:
+			event->objectEvent = mapGet(&objects, record->object, 1);
+			break;
+		case TRACE_KREALLOC:
+			event->objectEvent = mapGet(&objects, record->object, 1);
+			mapPut(&objects, record->object, i);
+			break;
+		case TRACE_CACHE_SHRINK:
+			event->cacheEvent = mapGet(&caches, record->cache, 0);
+			break;
+		case TRACE_CACHE_DESTROY:
+			event->cacheEvent = mapGet(&caches, record->cache, 1);
+			break;
+		}
+
+		int thread = 0;
+		while (thread < distinctThreads && threadIds[thread] != record->threadId) ++thread;
+		if (thread == distinctThreads && distinctThreads < REPLAY_MAX_THREADS)
+			threadIds[distinctThreads++] = record->threadId;
+		event->worker = thread % numThreads;
+	}
+
+	mapFree(&caches);
+	mapFree(&objects);
+}
+
+void waitForEvent(int event) {
+	while (!replayDone[event])
+		SwitchToThread();
+}
+
+void waitForAllBefore(int event) {
+	LONG current = replayWatermark;
+	while (current < event) {
+		waitForEvent(current);
+		++current;
+	}
+	LONG observed = replayWatermark;
+	while (observed < current) {
+		LONG previous = InterlockedCompareExchange(&replayWatermark, current, observed);
+		if (previous == observed) break;
+		observed = previous;
+	}
+}
+
+void takeSample(LONG eventsDone) {
+	LARGE_INTEGER now;
+	ReplaySample* sample = &replaySamples[eventsDone / REPLAY_SAMPLE_EVENTS];
+	QueryPerformanceCounter(&now);
+	sample->eventsDone = eventsDone;
+	sample->seconds = (double)(now.QuadPart - replayStart.QuadPart) / replayFrequency.QuadPart;
+	kmem_arena_stats(&sample->stats);
+}
+
+void replayEvent(int index) {
+	ReplayEvent* event = &replayEvents[index];
+	kmem_cache_t* cache = NULL;
+	void* object = NULL, * result = NULL;
+
+	if (event->cacheEvent >= 0) {
+		waitForEvent(event->cacheEvent);
+		cache = replayResults[event->cacheEvent];
+	}
+	if (event->objectEvent >= 0) {
+		waitForEvent(event->objectEvent);
+		object = replayResults[event->objectEvent];
+	}
+
+	switch (event->record.type) {
+	case TRACE_CACHE_CREATE:
+		waitForAllBefore(index);
+		result = kmem_cache_create(event->name, (size_t) event->record.size, NULL, NULL);
+		break;
+	case TRACE_CACHE_ALLOC:
+		if (cache) result = kmem_cache_alloc(cache);
+		break;
+	case TRACE_CACHE_FREE:
+		if (cache && object) kmem_cache_free(cache, object);
+		break;
+	case TRACE_KMALLOC:
+		result = kmalloc((size_t) event->record.size);
+		break;
+	case TRACE_KFREE:
+		if (object) kfree(object);
+		break;
+	case TRACE_KREALLOC:
+		if (object) result = krealloc(object, (size_t) event->record.size);
+		break;
+	case TRACE_CACHE_SHRINK:
+		if (cache) kmem_cache_shrink(cache);
+		break;
+	case TRACE_CACHE_DESTROY:
+		waitForAllBefore(index); //svi objekti kesa moraju prvo biti oslobodjeni
+		if (cache) kmem_cache_destroy(cache);
+		break;
+	}
+
+	replayResults[index] = result;
+	InterlockedExchange(&replayDone[index], 1);
+
+	LONG eventsDone = InterlockedIncrement(&replayProgress);
+	if (eventsDone % REPLAY_SAMPLE_EVENTS == 0)
+		takeSample(eventsDone);
+}
+
+void replayWork(void* data) {
+	ReplayWorker* worker = data;
+	for (int i = 0; i < worker->count; i++)
+		replayEvent(worker->events[i]);
+}
+
+int kmem_trace_replay(const char* fileName, int num_threads, size_t block_num)
+{
+	int numEvents = 0;
+	if (fileName == NULL || block_num == 0) return -1;
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > REPLAY_MAX_THREADS) num_threads = REPLAY_MAX_THREADS;
+	if (loadTrace(fileName, &numEvents)) {
+		printf("Trag %s ne moze da se ucita\n", fileName);
+		return -1;
+	}
+
+	resolveTrace(numEvents, num_threads);
+	replayResults = calloc(numEvents + 1, sizeof(void*));
+	replayDone = calloc(numEvents + 1, sizeof(LONG));
+	replaySamples = calloc(numEvents / REPLAY_SAMPLE_EVENTS + 1, sizeof(ReplaySample));
+	replayProgress = replayWatermark = 0;
+
+	ReplayWorker workers[REPLAY_MAX_THREADS];
+	for (int i = 0; i < num_threads; i++) {
+		workers[i].events = malloc(sizeof(int) * (numEvents + 1));
+		workers[i].count = 0;
+	}
+	for (int i = 0; i < numEvents; i++) {
+		ReplayWorker* worker = &workers[replayEvents[i].worker];
+		worker->events[worker->count++] = i;
+	}
+
+	void* space = malloc((size_t) BLOCK_SIZE * block_num);
+	kmem_init(space, block_num);
+
+	QueryPerformanceFrequency(&replayFrequency);
+	QueryPerformanceCounter(&replayStart);
+	if (num_threads == 1)
+		replayWork(&workers[0]);
+	else {
+		HANDLE threads[REPLAY_MAX_THREADS];
+		for (int i = 0; i < num_threads; i++)
+			threads[i] = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) replayWork, &workers[i], 0, NULL);
+		for (int i = 0; i < num_threads; i++) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+	}
+	LARGE_INTEGER end;
+	QueryPerformanceCounter(&end);
+	double seconds = (double)(end.QuadPart - replayStart.QuadPart) / replayFrequency.QuadPart;
+
+	BuddyStats finalStats;
+	kmem_arena_stats(&finalStats);
+
+	printf("----REPLAY %s----\n", fileName);
+	printf("Dogadjaja: %d ; Niti: %d ; Vreme: %f s ; Propusnost: %f dogadjaja/s\n", numEvents, num_threads, seconds,
+		numEvents / (seconds > 0 ? seconds : 1));
+	printf("Najvise zauzetih blokova: %zu od %zu\n", finalStats.peakBlocks, block_num);
+	printf("Dogadjaj ; Vreme (s) ; Zauzeto blokova ; Slobodno blokova ; Najveci slobodan chunk ; Fragmentacija\n");
+	for (int i = 1; i <= numEvents / REPLAY_SAMPLE_EVENTS; i++) {
+		BuddyStats* stats = &replaySamples[i].stats;
+		double fragmentation = stats->freeBlocks == 0 ? 0 : 1 - (double) stats->largestChunk / stats->freeBlocks;
+		printf("%ld ; %f ; %zu ; %zu ; %zu ; %f%%\n", replaySamples[i].eventsDone, replaySamples[i].seconds,
+			stats->usedBlocks, stats->freeBlocks, stats->largestChunk, fragmentation * 100);
+	}
+	printf("--------\n");
+
+	//arena se ne oslobadja, globalni pokazivaci alokatora procesa i dalje pokazuju na nju
+	for (int i = 0; i < num_threads; free(workers[i++].events));
+	free(replaySamples);
+	free((void*) replayDone);
+	free((void*) replayResults);
+	free(replayEvents);
+	return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+// File: replay.h
+#include "trace.h"
+
+//replay je samostalan program: preuzima alokator procesa, pa se poziva umesto kmem_init i ne kombinuje se sa drugim arenama
+int kmem_trace_replay(const char* fileName, int num_threads, size_t block_num); // Initialize the process allocator on a fresh arena, replay a trace and print report
@@ -1,74 +1,161 @@
 #include "slab_structs.h"
 #include "buddy.h"
 #include "slab.h"
+#include "profiler.h"
+#include "trace.h"
+#include "lock.h"
 #include <stdio.h>
 #include <windows.h>
 
-typedef struct slab_alloc_metadata {
-	kmem_cache_t* cacheList;
-	kmem_cache_t* smallBufferCaches[MAX_DEG_SMALL - MIN_DEG_SMALL + 1];
-	HANDLE mutex;
-	BuddyMetadata* buddy;
-};
-
+//sve veze unutar arene su pomeraji (ArenaOffset), pa metapodaci vaze na bilo kojoj adresi mapiranja
 struct slab_metadata {
 	int freeObjectsLeft;
-	struct slab_metadata* nextSlab, *prevSlab;
-	char* occupyBits, * startingAddress, * freeList;
+	ArenaOffset nextSlab, prevSlab;
+	ArenaOffset occupyBits, startingAddress, freeList;
+};
+
+struct large_buffer {
+	ArenaOffset address;
+	size_t size;
+	ArenaOffset next, prev;
 };
 
 struct kmem_cache_s {
 	char name[MAX_NAME_LENGTH];
-	kmem_cache_t* nextCache, * prevCache;
-	SlabMetadata* fullSlabs, * partialSlabs, * emptySlabs;
-	size_t objectSize, actualSize;
+	ArenaOffset nextCache, prevCache;
+	ArenaOffset fullSlabs, partialSlabs, emptySlabs;
+	size_t objectSize, actualSize, align; //align je poravnanje objekata, stepen dvojke
 	int slabSizeInBlocks, occupyBytes, numberOfSlabs, objectsPerSlab, lastErrorCode, canShrink, deallocCount;
-	int remainingSpace, cacheShifting, nextOffset;
+	size_t remainingSpace, nextOffset;
+	int cacheShifting;
+	ArenaOffset mergedInto; //zajednicki skup ploca, 0 ako kes ima svoje ploce
+	int aliasCount, liveObjects; //broj keseva koji dele ovaj skup / zivih objekata kesa koji deli skup
+	int ownerTags, ownerTag; //ploce skupa cuvaju oznaku vlasnika svakog objekta / oznaka kesa u skupu, za skup poslednja dodeljena
+	int reserveSlabs, reserveMisses, refillPending; //prazne ploce koje pozadinska nit odrzava / alokacije koje su ipak pravile plocu
+	int internal; //kes samog alokatora (opisi keseva i velikih bafera), profajler ga ne prati
+	int refilling; //broj niti koje upravo dopunjuju kes, menja se pod globalnom bravom; opis kesa se ne oslobadja dok nije 0
 	void(*ctor)(void*);
 	void(*dtor)(void*);
-	HANDLE mutex;
+	int(*move)(void*, void*); //premestanje objekta pri sazimanju, NULL ako kes ne dozvoljava sazimanje
+	KmemLock mutex;
 };
 
+typedef struct slab_alloc_metadata {
+	ArenaOffset cacheList;
+	ArenaOffset smallBufferCaches[MAX_DEG_SMALL - MIN_DEG_SMALL + 1];
+	ArenaOffset largeBufferCache;
+	ArenaOffset mergedCaches;
+	ArenaOffset largeBuffers;
+	int cacheMerging, shared;
+	KmemLock mutex;
+	struct kmem_cache_s cacheCache; //opisi keseva se uzimaju iz ovog kesa, ne kao ceo blok svaki
+};
+
+//adrese arene u ovom procesu
 SlabAllocMetadata* slabAllocator = NULL;
+BuddyMetadata* buddyAllocator = NULL;
+
+HANDLE refillerEvent = NULL, refillerThread = NULL;
+
+#define POINTER(offset) ARENA_POINTER(buddyAllocator, offset)
+#define OFFSET(pointer) ARENA_OFFSET(buddyAllocator, pointer)
+#define SLAB(offset) ((SlabMetadata*) POINTER(offset))
+#define CACHE(offset) ((kmem_cache_t*) POINTER(offset))
+#define LARGE(offset) ((LargeBuffer*) POINTER(offset))
+
+//opisi keseva se uzimaju iz kesa keseva i pre definicije ovih funkcija
+void setCacheFields(kmem_cache_t* cache, size_t size, size_t align, const char* name, void(*ctor)(void*), void(*dtor)(void*), int ownerTags);
+void* kmem_cache_alloc_trusted(kmem_cache_t* cachep);
+int kmem_cache_free_trusted(kmem_cache_t* cachep, void* objp);
+
+void initAllocator(void* space, size_t block_num, int shared) {
+	if (space == NULL || block_num == 0) return; //neispravni argumenti
+	BuddyMetadata* buddy = buddy_init(space, block_num, sizeof(SlabAllocMetadata));
+	if (buddy == NULL) return; //nije dato dovoljno mesta
+
+	SlabAllocMetadata* tempPointer = buddy_get_root(buddy);
+	tempPointer->cacheList = 0;
+	for (int i = 0; i < MAX_DEG_SMALL - MIN_DEG_SMALL + 1; tempPointer->smallBufferCaches[i++] = 0);
+	tempPointer->largeBufferCache = 0;
+	tempPointer->mergedCaches = 0;
+	tempPointer->largeBuffers = 0;
+	tempPointer->cacheMerging = 0;
+	tempPointer->shared = shared;
+	lock_init(&tempPointer->mutex, shared);
+	buddyAllocator = buddy;
+	slabAllocator = tempPointer;
+	tempPointer->cacheCache.prevCache = tempPointer->cacheCache.nextCache = 0;
+	setCacheFields(&tempPointer->cacheCache, sizeof(kmem_cache_t), CACHE_L1_LINE_SIZE, CACHE_CACHE_NAME, NULL, NULL, 0); //brave susednih keseva nisu u istoj liniji
+	tempPointer->cacheCache.internal = 1;
+}
 
-void kmem_init(void* space, int block_num)
+void kmem_init(void* space, size_t block_num)
 {
-	if (space == NULL || block_num <= 0) return; //neispravni argumenti
-	BuddyMetadata* buddy = buddy_init(space, block_num);
-	if (buddy == NULL) return NULL; //nije dato dovoljno mesta
-
-	SlabAllocMetadata* tempPointer = buddy_take(buddy, sizeof(SlabAllocMetadata));
-	tempPointer->buddy = buddy;
-	tempPointer->cacheList = NULL;
-	for (int i = 0; i < MAX_DEG_SMALL - MIN_DEG_SMALL + 1; tempPointer->smallBufferCaches[i++] = NULL);
-	tempPointer->mutex = CreateMutex(NULL, FALSE, NULL);
-	slabAllocator = tempPointer;
+	initAllocator(space, block_num, 0);
+}
+
+void kmem_init_shared(void* space, size_t block_num)
+{
+	initAllocator(space, block_num, 1);
+}
+
+int kmem_attach(void* space)
+{
+	if (space == NULL) return 0; //neispravan argument
+
+	SlabAllocMetadata* root = buddy_get_root(space);
+	if (root == NULL || !root->shared) return 0; //arena nije napravljena sa kmem_init_shared
+	buddyAllocator = space;
+	slabAllocator = root;
+	return 1;
 }
 
-void setCacheFields(kmem_cache_t* cache, size_t size, const char* name, void(*ctor)(void*), void(*dtor)(void*)) {
+size_t kmem_offset(const void* objp)
+{
+	if (slabAllocator == NULL) return 0; //alokator nije inicijalizovan
+	return OFFSET(objp);
+}
+
+void* kmem_pointer(size_t offset)
+{
+	if (slabAllocator == NULL) return NULL; //alokator nije inicijalizovan
+	return POINTER(offset);
+}
+
+void setCacheFields(kmem_cache_t* cache, size_t size, size_t align, const char* name, void(*ctor)(void*), void(*dtor)(void*), int ownerTags) {
 	strcpy_s(cache->name, MAX_NAME_LENGTH, name);
-	cache->emptySlabs = cache->partialSlabs = cache->fullSlabs = NULL;
+	cache->emptySlabs = cache->partialSlabs = cache->fullSlabs = 0;
 	cache->objectSize = size;
 	cache->lastErrorCode = 0;
 	cache->canShrink = 1;
 	cache->ctor = ctor;
 	cache->dtor = dtor;
+	cache->move = NULL;
 	cache->numberOfSlabs = 0;
 	cache->deallocCount = 0;
+	cache->mergedInto = 0;
+	cache->aliasCount = cache->liveObjects = 0;
+	cache->ownerTags = ownerTags;
+	cache->ownerTag = 0;
+	cache->reserveSlabs = cache->reserveMisses = cache->refillPending = cache->refilling = 0;
+	cache->internal = 0;
 	cache->objectsPerSlab = MIN_OBJECTS_PER_SLAB;
 
 	int blocksNeeded = 1;
 	size_t actualSize = size >= sizeof(void*) ? size : sizeof(void*);
+	actualSize = (actualSize + align - 1) & ~(align - 1); //svaki sledeci objekat ostaje poravnat
 	cache->actualSize = actualSize;
+	cache->align = align;
+	actualSize += ownerTags ? 1 : 0; //bajt oznake vlasnika se racuna uz svaki objekat
 	int occupyBytesNeeded = MIN_OBJECTS_PER_SLAB / 8 + (MIN_OBJECTS_PER_SLAB % 8 == 0 ? 0 : 1);
 
-	int spaceNeeded = sizeof(SlabMetadata) + MIN_OBJECTS_PER_SLAB * actualSize + occupyBytesNeeded;
+	size_t spaceNeeded = sizeof(SlabMetadata) + align - 1 + MIN_OBJECTS_PER_SLAB * actualSize + occupyBytesNeeded; //align - 1 za poravnanje prvog objekta
 	//printf("minimalna velicina slaba: %d\n", spaceNeeded);
-	while (blocksNeeded * BLOCK_SIZE < spaceNeeded)
+	while ((size_t) blocksNeeded * BLOCK_SIZE < spaceNeeded)
 		blocksNeeded <<= 1;
 	cache->slabSizeInBlocks = blocksNeeded;
 	//printf("potrebno blokova: %d\n", blocksNeeded);
-	int remainingSpace = blocksNeeded * BLOCK_SIZE - spaceNeeded;
+	size_t remainingSpace = (size_t) blocksNeeded * BLOCK_SIZE - spaceNeeded;
 
 	cache->objectsPerSlab += remainingSpace / (actualSize * 8 + 1) * 8;
 	occupyBytesNeeded += remainingSpace / (actualSize * 8 + 1);
@@ -90,63 +177,180 @@ void setCacheFields(kmem_cache_t* cache, size_t size, const char* name, void(*ct
 
 	cache->remainingSpace = remainingSpace;
 	cache->occupyBytes = occupyBytesNeeded;
-	cache->cacheShifting = remainingSpace >= CACHE_L1_LINE_SIZE ? 1 : 0;
+	cache->cacheShifting = remainingSpace >= CACHE_L1_LINE_SIZE && align <= CACHE_L1_LINE_SIZE ? 1 : 0; //pomeraj boje cuva poravnanje
 	cache->nextOffset = 0;
-	cache->mutex = CreateMutex(NULL, FALSE, NULL);
+	lock_init(&cache->mutex, slabAllocator->shared);
+}
+
+void kmem_cache_set_merging(int enabled)
+{
+	if (slabAllocator == NULL) return; //alokator nije inicijalizovan
+
+	lock_acquire(&slabAllocator->mutex);
+	slabAllocator->cacheMerging = enabled;
+	lock_release(&slabAllocator->mutex);
+}
+
+kmem_cache_t* getMergedPool(size_t size, size_t align) {
+	size_t actualSize = size >= sizeof(void*) ? size : sizeof(void*);
+	actualSize = (actualSize + align - 1) & ~(align - 1);
+	kmem_cache_t* currCache = CACHE(slabAllocator->mergedCaches);
+	while (currCache != NULL && (currCache->actualSize != actualSize || currCache->align != align || currCache->ownerTag == MAX_OWNER_TAG))
+		currCache = CACHE(currCache->nextCache);
+	if (currCache != NULL) return currCache;
+
+	kmem_cache_t* pool = kmem_cache_alloc_trusted(&slabAllocator->cacheCache);
+	if (pool == NULL) return NULL; //nema prostora
+
+	char name[MAX_NAME_LENGTH] = "merged-", numBuf[MAX_NAME_LENGTH];
+	_itoa_s(actualSize, numBuf, MAX_NAME_LENGTH, 10);
+	strcat_s(name, MAX_NAME_LENGTH, numBuf);
+	setCacheFields(pool, actualSize, align, name, NULL, NULL, 1);
+
+	pool->prevCache = 0;
+	if (slabAllocator->mergedCaches != 0)
+		CACHE(slabAllocator->mergedCaches)->prevCache = OFFSET(pool);
+	pool->nextCache = slabAllocator->mergedCaches;
+	slabAllocator->mergedCaches = OFFSET(pool);
+	return pool;
+}
+
+//poziva se pod globalnom bravom uzetom jednom; posle povratka nijedna nit ne dopunjuje kes
+void stopRefill(kmem_cache_t* cachep) {
+	cachep->reserveSlabs = cachep->refillPending = 0;
+	while (cachep->refilling > 0) {
+		lock_release(&slabAllocator->mutex);
+		SwitchToThread();
+		lock_acquire(&slabAllocator->mutex);
+	}
+}
+
+void destroyMergedPool(kmem_cache_t* pool) {
+	if (pool->partialSlabs != 0 || pool->fullSlabs != 0) return; //skup sa zivim objektima ostaje u listi, da se ploce ne izgube
+
+	if (pool->nextCache != 0)
+		CACHE(pool->nextCache)->prevCache = pool->prevCache;
+	if (pool->prevCache != 0)
+		CACHE(pool->prevCache)->nextCache = pool->nextCache;
+	else
+		slabAllocator->mergedCaches = pool->nextCache;
+	stopRefill(pool); //skup je van liste, pa ga dok se ceka niko ne moze ponovo izabrati
+
+	lock_destroy(&pool->mutex);
+
+	SlabMetadata* currSlab = SLAB(pool->emptySlabs);
+	while (currSlab != NULL) {
+		SlabMetadata* nextSlab = SLAB(currSlab->nextSlab);
+		buddy_give(buddyAllocator, currSlab, (size_t) pool->slabSizeInBlocks * BLOCK_SIZE);
+		currSlab = nextSlab;
+	}
+	kmem_cache_free_trusted(&slabAllocator->cacheCache, pool);
 }
 
 kmem_cache_t* kmem_cache_create(const char* name, size_t size, void(*ctor)(void*), void(*dtor)(void*))
+{
+	return kmem_cache_create_aligned(name, size, 1, ctor, dtor);
+}
+
+kmem_cache_t* kmem_cache_create_aligned(const char* name, size_t size, size_t align, void(*ctor)(void*), void(*dtor)(void*))
 {
 
 	if (slabAllocator == NULL || size == 0) return NULL; //neispravna velicina ili alokator nije inicijalizovan
+	if (align == 0 || (align & (align - 1)) || align > BLOCK_SIZE) return NULL; //poravnanje mora biti stepen dvojke, najvise BLOCK_SIZE
+	if (slabAllocator->shared && (ctor != NULL || dtor != NULL)) return NULL; //adresa funkcije iz deljene arene ne vazi u drugim procesima
 	
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
+	lock_acquire(&slabAllocator->mutex);
 	//printf("kmem_cache_create (%s , %d)\n",name,size);
-	kmem_cache_t* cache = buddy_take(slabAllocator->buddy, sizeof(kmem_cache_t));
+	kmem_cache_t* cache = kmem_cache_alloc_trusted(&slabAllocator->cacheCache);
 	if (cache == NULL) {
-		ReleaseMutex(slabAllocator->mutex);
+		lock_release(&slabAllocator->mutex);
 		return NULL; //nema prostora
 	}
-	cache->prevCache = NULL;
-	if (slabAllocator->cacheList != NULL)
-		slabAllocator->cacheList->prevCache = cache;
+
+	//kesevi bez konstruktora i destruktora iste stvarne velicine imaju isti raspored ploce, pa mogu da dele ploce
+	kmem_cache_t* mergedPool = NULL;
+	int ownerTag = 0;
+	if (slabAllocator->cacheMerging && ctor == NULL && dtor == NULL) {
+		mergedPool = getMergedPool(size, align);
+		if (mergedPool == NULL) {
+			kmem_cache_free_trusted(&slabAllocator->cacheCache, cache);
+			lock_release(&slabAllocator->mutex);
+			return NULL; //nema prostora
+		}
+		++(mergedPool->aliasCount);
+		ownerTag = ++(mergedPool->ownerTag);
+	}
+
+	cache->prevCache = 0;
+	if (slabAllocator->cacheList != 0)
+		CACHE(slabAllocator->cacheList)->prevCache = OFFSET(cache);
 	cache->nextCache = slabAllocator->cacheList;
-	slabAllocator->cacheList = cache;
+	slabAllocator->cacheList = OFFSET(cache);
 	
-	ReleaseMutex(slabAllocator->mutex);
+	lock_release(&slabAllocator->mutex);
+
+	setCacheFields(cache, size, align, name, ctor, dtor, 0);
+	cache->mergedInto = OFFSET(mergedPool);
+	cache->ownerTag = ownerTag;
 
-	setCacheFields(cache, size, name, ctor, dtor);
+	if (tracerActive)
+		trace_event(TRACE_CACHE_CREATE, cache, NULL, size, cache->name);
 	
 	//kmem_cache_info(cache);
 	return cache;
 }
 
+kmem_cache_t* kmem_cache_find(const char* name)
+{
+	if (slabAllocator == NULL || name == NULL) return NULL; //neispravan argument ili alokator nije inicijalizovan
+
+	lock_acquire(&slabAllocator->mutex);
+	kmem_cache_t* currCache = CACHE(slabAllocator->cacheList);
+	while (currCache != NULL && strcmp(currCache->name, name) != 0)
+		currCache = CACHE(currCache->nextCache);
+	lock_release(&slabAllocator->mutex);
+	return currCache;
+}
+
 int kmem_cache_shrink_trusted(kmem_cache_t* cachep) {
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) return 0; //kes je obrisan u medjuvremenu
+	if (cachep->mergedInto != 0)
+		return kmem_cache_shrink_trusted(CACHE(cachep->mergedInto)); //ploce pripadaju zajednickom skupu
+
+	if (!lock_acquire(&cachep->mutex)) return 0; //kes je obrisan u medjuvremenu
 	if (!cachep->canShrink) {
 		//printf("cant shrink \n");
 		cachep->canShrink = 1;
-		ReleaseMutex(cachep->mutex);
+		lock_release(&cachep->mutex);
 		return 0;
 	}
 
-	int blocksFreed = 0;
-	SlabMetadata* currSlab = cachep->emptySlabs;
+	int blocksFreed = 0, keptSlabs = 0;
+	SlabMetadata* currSlab = SLAB(cachep->emptySlabs), * lastKept = NULL;
+	while (currSlab != NULL && keptSlabs < cachep->reserveSlabs) {
+		lastKept = currSlab; //rezervisane ploce se ne vracaju
+		++keptSlabs;
+		currSlab = SLAB(currSlab->nextSlab);
+	}
+	if (lastKept != NULL)
+		lastKept->nextSlab = 0;
+	else
+		cachep->emptySlabs = 0;
+
 	while (currSlab != NULL) {
-		WaitForSingleObject(slabAllocator->mutex, INFINITE);
+		SlabMetadata* nextSlab = SLAB(currSlab->nextSlab);
+		lock_acquire(&slabAllocator->mutex);
 		//printf("kmem_cache_shrink (%s)\n", cachep->name);
-		buddy_give(slabAllocator->buddy, currSlab, cachep->slabSizeInBlocks * BLOCK_SIZE);
-		ReleaseMutex(slabAllocator->mutex);
+		buddy_give(buddyAllocator, currSlab, (size_t) cachep->slabSizeInBlocks * BLOCK_SIZE);
+		lock_release(&slabAllocator->mutex);
 
 		blocksFreed += cachep->slabSizeInBlocks;
 		--(cachep->numberOfSlabs);
-		currSlab = currSlab->nextSlab;
+		currSlab = nextSlab;
 	}
-	cachep->emptySlabs = NULL;
 	cachep->lastErrorCode = 0;
 
 	//printf("can shrink, blokova %d\n", blocksFreed);
-	ReleaseMutex(cachep->mutex);
+	lock_release(&cachep->mutex);
 }
 
 int kmem_cache_shrink(kmem_cache_t* cachep)
@@ -155,37 +359,47 @@ int kmem_cache_shrink(kmem_cache_t* cachep)
 
 	if (!cacheExists(cachep)) return 0; //nevalidna adresa kesa
 
+	if (tracerActive)
+		trace_event(TRACE_CACHE_SHRINK, cachep, NULL, 0, NULL);
+
 	return kmem_cache_shrink_trusted(cachep);
 }
 
 void setOccupyBit(kmem_cache_t* cachep, SlabMetadata* slab, char* obj, char bit) {
-	unsigned distance = obj - slab->startingAddress;
+	size_t distance = obj - (char*) POINTER(slab->startingAddress);
 	distance /= cachep->actualSize;
 	int selectedByte = distance / 8;
 	int selectedBit = distance % 8;
 	unsigned char bitMask = 1;
 	bitMask <<= selectedBit;
 	if (bit)
-		slab->occupyBits[selectedByte] |= bitMask;
+		((char*) POINTER(slab->occupyBits))[selectedByte] |= bitMask;
 	else
-		slab->occupyBits[selectedByte] &= ~bitMask;
+		((char*) POINTER(slab->occupyBits))[selectedByte] &= ~bitMask;
 	//printf("setujem bit bajta %d bit %d vrednost %d\n",selectedByte,selectedBit, bit);
 }
 
 char getOccupyBit(kmem_cache_t* cachep, SlabMetadata* slab, char* obj) {
-	unsigned distance = obj - slab->startingAddress;
+	size_t distance = obj - (char*) POINTER(slab->startingAddress);
 	distance /= cachep->actualSize;
 	int selectedByte = distance / 8;
 	int selectedBit = distance % 8;
 	unsigned char bitMask = 1;
 	bitMask <<= selectedBit;
 	//printf("getujem bit bajta %d bit %d vrednost %d\n", selectedByte, selectedBit, (slab->occupyBits[selectedByte] & bitMask) ? 1 : 0);
-	return (slab->occupyBits[selectedByte] & bitMask) ? 1 : 0;
+	return (((char*) POINTER(slab->occupyBits))[selectedByte] & bitMask) ? 1 : 0;
+}
+
+//oznake vlasnika su niz bajtova izmedju bitova zauzetosti i prvog objekta
+unsigned char* getOwnerTag(kmem_cache_t* cachep, SlabMetadata* slab, char* obj) {
+	size_t distance = obj - (char*) POINTER(slab->startingAddress);
+	distance /= cachep->actualSize;
+	return (unsigned char*) POINTER(slab->occupyBits) + cachep->occupyBytes + distance;
 }
 
 void* getFreeObject(kmem_cache_t* cachep, SlabMetadata* slab) {
-	void* retVal = slab->freeList;
-	char** nextObject = slab->freeList;
+	void* retVal = POINTER(slab->freeList);
+	ArenaOffset* nextObject = retVal;
 	slab->freeList = *nextObject;
 	--(slab->freeObjectsLeft);
 	setOccupyBit(cachep, slab, retVal, 1);
@@ -193,93 +407,264 @@ void* getFreeObject(kmem_cache_t* cachep, SlabMetadata* slab) {
 }
 
 SlabMetadata* createNewSlab(kmem_cache_t* cachep) {
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
+	lock_acquire(&slabAllocator->mutex);
 
 	//printf("createNewSlab (%s)\n",cachep->name);
-	SlabMetadata* newSlab = buddy_take(slabAllocator->buddy, cachep->slabSizeInBlocks * BLOCK_SIZE);
+	SlabMetadata* newSlab = buddy_take(buddyAllocator, (size_t) cachep->slabSizeInBlocks * BLOCK_SIZE);
+
+	//pomeraj boje se menja pod globalnom bravom, jer ploce pravi i pozadinska nit bez brave kesa
+	size_t colourOffset = cachep->nextOffset;
+	if (newSlab != NULL && cachep->cacheShifting) {
+		cachep->nextOffset += CACHE_L1_LINE_SIZE;
+		if (cachep->nextOffset > cachep->remainingSpace)
+			cachep->nextOffset = 0;
+	}
 	
-	ReleaseMutex(slabAllocator->mutex);
+	lock_release(&slabAllocator->mutex);
 	
 	if(newSlab == NULL){
 		return NULL;
 	}
 	
-	newSlab->prevSlab = NULL;
+	newSlab->prevSlab = 0;
 	newSlab->freeObjectsLeft = cachep->objectsPerSlab;
 	
-	newSlab->occupyBits = newSlab;
-	newSlab->occupyBits += sizeof(SlabMetadata);
-	for (int i = 0; i < cachep->occupyBytes; newSlab->occupyBits[i++] = 0);
+	char* occupyBits = newSlab;
+	occupyBits += sizeof(SlabMetadata);
+	for (int i = 0; i < cachep->occupyBytes; occupyBits[i++] = 0);
+	newSlab->occupyBits = OFFSET(occupyBits);
 	
 	newSlab->startingAddress = newSlab->occupyBits + cachep->occupyBytes;
-	if (cachep->cacheShifting) {
-		newSlab->startingAddress += cachep->nextOffset;
-		cachep->nextOffset += CACHE_L1_LINE_SIZE;
-		if (cachep->nextOffset > cachep->remainingSpace)
-			cachep->nextOffset = 0;
-	}
+	if (cachep->ownerTags)
+		newSlab->startingAddress += cachep->objectsPerSlab;
+	//poravnava se adresa, ne pomeraj; deljena arena se mapira na adresu poravnatu bar na stranicu, pa vazi u svim procesima
+	newSlab->startingAddress += (cachep->align - (size_t) POINTER(newSlab->startingAddress) % cachep->align) % cachep->align;
+	if (cachep->cacheShifting)
+		newSlab->startingAddress += colourOffset;
 	
 	newSlab->freeList = newSlab->startingAddress;
-	char* currObj = newSlab->startingAddress;
+	char* currObj = POINTER(newSlab->startingAddress);
 	for (int i = 0; i < cachep->objectsPerSlab - 1; i++) {
-		char** nextObj = currObj;
-		*nextObj = currObj + cachep->actualSize;
+		ArenaOffset* nextObj = currObj;
+		*nextObj = OFFSET(currObj + cachep->actualSize);
 		currObj += cachep->actualSize;
 	}
-	char** nextObj = currObj;
-	*nextObj = NULL;
+	ArenaOffset* nextObj = currObj;
+	*nextObj = 0;
 
 	return newSlab;
 }
 
 int cacheExists(kmem_cache_t* cachep) {
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
-	kmem_cache_t* currCache = slabAllocator->cacheList;
+	lock_acquire(&slabAllocator->mutex);
+	kmem_cache_t* currCache = CACHE(slabAllocator->cacheList);
 	while (currCache!= NULL) {
 		if (currCache == cachep) {
-			ReleaseMutex(slabAllocator->mutex);
+			lock_release(&slabAllocator->mutex);
 			return 1;
 		} 
-		currCache = currCache->nextCache;
+		currCache = CACHE(currCache->nextCache);
 	}
-	ReleaseMutex(slabAllocator->mutex);
+	lock_release(&slabAllocator->mutex);
 	return 0;
 }
 
-void* kmem_cache_alloc_trusted(kmem_cache_t* cachep) {
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) return NULL; //kes je obrisan u medjuvremenu
+int countEmptySlabs(kmem_cache_t* cachep) {
+	int count = 0;
+	SlabMetadata* currSlab = SLAB(cachep->emptySlabs);
+	while (currSlab != NULL) {
+		++count;
+		currSlab = SLAB(currSlab->nextSlab);
+	}
+	return count;
+}
+
+void requestRefill(kmem_cache_t* cachep) {
+	cachep->refillPending = 1;
+	if (refillerEvent != NULL)
+		SetEvent(refillerEvent);
+}
+
+//poziva se pod globalnom bravom; zajednicki skupovi nisu u listi keseva
+int cacheListed(kmem_cache_t* cachep) {
+	for (int i = 0; i < 2; i++) {
+		kmem_cache_t* currCache = CACHE(i == 0 ? slabAllocator->cacheList : slabAllocator->mergedCaches);
+		while (currCache != NULL && currCache != cachep)
+			currCache = CACHE(currCache->nextCache);
+		if (currCache != NULL) return 1;
+	}
+	return 0;
+}
+
+int beginRefill(kmem_cache_t* cachep) {
+	lock_acquire(&slabAllocator->mutex);
+	int listed = cacheListed(cachep);
+	if (listed)
+		++(cachep->refilling);
+	lock_release(&slabAllocator->mutex);
+	return listed;
+}
+
+void endRefill(kmem_cache_t* cachep) {
+	lock_acquire(&slabAllocator->mutex);
+	--(cachep->refilling);
+	lock_release(&slabAllocator->mutex);
+}
+
+//nove ploce se prave van brave kesa, da alokacije iz rezerve ne cekaju na buddy alokator;
+//pozivalac je povecao refilling, pa opis kesa postoji, ali se pre svake ploce proverava da unistavanje nije ukinulo rezervu
+void refillCache(kmem_cache_t* cachep) {
+	size_t slabSize = (size_t) cachep->slabSizeInBlocks * BLOCK_SIZE;
+	while (1) {
+		lock_acquire(&slabAllocator->mutex);
+		int active = cacheListed(cachep) && cachep->reserveSlabs > 0;
+		lock_release(&slabAllocator->mutex);
+		if (!active) return; //kes se unistava ili je rezerva ukinuta
+
+		if (!lock_acquire(&cachep->mutex)) return; //kes je obrisan u medjuvremenu
+		int missingSlabs = cachep->reserveSlabs - countEmptySlabs(cachep);
+		lock_release(&cachep->mutex);
+		if (missingSlabs <= 0) return;
+
+		SlabMetadata* newSlab = createNewSlab(cachep);
+		if (newSlab == NULL) return; //nema prostora
+
+		if (!lock_acquire(&cachep->mutex)) {
+			lock_acquire(&slabAllocator->mutex);
+			buddy_give(buddyAllocator, newSlab, slabSize);
+			lock_release(&slabAllocator->mutex);
+			return; //kes je obrisan u medjuvremenu
+		}
+		newSlab->nextSlab = cachep->emptySlabs;
+		if (cachep->emptySlabs != 0)
+			SLAB(cachep->emptySlabs)->prevSlab = OFFSET(newSlab);
+		cachep->emptySlabs = OFFSET(newSlab);
+		++(cachep->numberOfSlabs);
+		lock_release(&cachep->mutex);
+	}
+}
+
+kmem_cache_t* getPendingCache() {
+	lock_acquire(&slabAllocator->mutex);
+	kmem_cache_t* currCache = CACHE(slabAllocator->cacheList);
+	while (currCache != NULL && !currCache->refillPending)
+		currCache = CACHE(currCache->nextCache);
+	if (currCache == NULL) {
+		currCache = CACHE(slabAllocator->mergedCaches);
+		while (currCache != NULL && !currCache->refillPending)
+			currCache = CACHE(currCache->nextCache);
+	}
+	if (currCache != NULL) {
+		currCache->refillPending = 0;
+		++(currCache->refilling); //unistavanje ceka kraj dopune
+	}
+	lock_release(&slabAllocator->mutex);
+	return currCache;
+}
+
+void refillerWork(void* data) {
+	while (WaitForSingleObject(refillerEvent, INFINITE) == WAIT_OBJECT_0) {
+		kmem_cache_t* pendingCache;
+		while ((pendingCache = getPendingCache()) != NULL) {
+			refillCache(pendingCache);
+			endRefill(pendingCache);
+		}
+	}
+}
+
+int startRefiller() {
+	lock_acquire(&slabAllocator->mutex);
+	if (refillerThread == NULL) {
+		refillerEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (refillerEvent != NULL)
+			refillerThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) refillerWork, NULL, 0, NULL);
+	}
+	lock_release(&slabAllocator->mutex);
+	return refillerThread != NULL;
+}
+
+int kmem_cache_reserve(kmem_cache_t* cachep, int n_objects)
+{
+	if (slabAllocator == NULL || cachep == NULL || n_objects < 0) return 0; //neispravan argument ili alokator nije inicijalizovan
+
+	if (!cacheExists(cachep)) return 0; //nevalidna adresa kesa
+
+	if (slabAllocator->shared) return 0; //dogadjaj i nit za dopunu postoje samo u procesu koji ih je napravio
+
+	if (!startRefiller()) return 0; //nit za dopunu nije pokrenuta
+
+	kmem_cache_t* slabOwner = cachep->mergedInto != 0 ? CACHE(cachep->mergedInto) : cachep; //ploce pripadaju zajednickom skupu
+	if (!lock_acquire(&slabOwner->mutex)) return 0; //kes je obrisan u medjuvremenu
+	slabOwner->reserveSlabs = (n_objects + slabOwner->objectsPerSlab - 1) / slabOwner->objectsPerSlab;
+	lock_release(&slabOwner->mutex);
+
+	if (!beginRefill(slabOwner)) return 0; //kes je obrisan u medjuvremenu
+	refillCache(slabOwner); //prva dopuna je sinhrona, da rezerva bude spremna po povratku
+
+	int reservedObjects = 0;
+	if (lock_acquire(&slabOwner->mutex)) {
+		reservedObjects = countEmptySlabs(slabOwner) * slabOwner->objectsPerSlab;
+		lock_release(&slabOwner->mutex);
+	}
+	endRefill(slabOwner);
+	return reservedObjects;
+}
+
+//ownerTag je oznaka kesa koji zauzima objekat iz zajednickog skupa
+void* allocSlabObject(kmem_cache_t* cachep, int ownerTag) {
+	if (!lock_acquire(&cachep->mutex)) return NULL; //kes je obrisan u medjuvremenu
+
+	if (cachep->mergedInto != 0) {
+		void* mergedObject = allocSlabObject(CACHE(cachep->mergedInto), cachep->ownerTag);
+		if (mergedObject != NULL) {
+			++(cachep->liveObjects);
+			cachep->lastErrorCode = 0;
+		}
+		else cachep->lastErrorCode = ERRCODE_NO_SPACE;
+		lock_release(&cachep->mutex);
+
+		if (profilerActive && mergedObject != NULL)
+			profiler_alloc(cachep->name, mergedObject, cachep->objectSize);
+		return mergedObject;
+	}
 	SlabMetadata* selectedSlab = NULL;
 	void* returnedObject = NULL;
 
-	if (cachep->partialSlabs != NULL) {
+	if (cachep->partialSlabs != 0) {
 		//printf("izabran parcijalan slab\n");
-		selectedSlab = cachep->partialSlabs;
+		selectedSlab = SLAB(cachep->partialSlabs);
 		returnedObject = getFreeObject(cachep, selectedSlab);
 		if (!(selectedSlab->freeObjectsLeft)) {
-			cachep->partialSlabs = cachep->partialSlabs->nextSlab;
-			if (cachep->partialSlabs != NULL)
-				cachep->partialSlabs->prevSlab = NULL;
+			cachep->partialSlabs = selectedSlab->nextSlab;
+			if (cachep->partialSlabs != 0)
+				SLAB(cachep->partialSlabs)->prevSlab = 0;
 			selectedSlab->nextSlab = cachep->fullSlabs;
-			if (cachep->fullSlabs != NULL)
-				cachep->fullSlabs->prevSlab = selectedSlab;
-			cachep->fullSlabs = selectedSlab;
+			if (cachep->fullSlabs != 0)
+				SLAB(cachep->fullSlabs)->prevSlab = OFFSET(selectedSlab);
+			cachep->fullSlabs = OFFSET(selectedSlab);
 		}
 	}
 	else {
-		if (cachep->emptySlabs != NULL) {
+		if (cachep->emptySlabs != 0) {
 			//printf("izabran prazan slab\n");
-			selectedSlab = cachep->emptySlabs;
+			selectedSlab = SLAB(cachep->emptySlabs);
 			returnedObject = getFreeObject(cachep, selectedSlab);
-			cachep->emptySlabs = cachep->emptySlabs->nextSlab;
-			if (cachep->emptySlabs != NULL)
-				cachep->emptySlabs->prevSlab = NULL;
+			cachep->emptySlabs = selectedSlab->nextSlab;
+			if (cachep->emptySlabs != 0)
+				SLAB(cachep->emptySlabs)->prevSlab = 0;
+			if (cachep->reserveSlabs > 0)
+				requestRefill(cachep);
 		}
 		else {
 			//printf("izabran nov slab\n");
+			if (cachep->reserveSlabs > 0) {
+				++(cachep->reserveMisses); //rezerva je potrosena, ploca se pravi sinhrono
+				requestRefill(cachep);
+			}
 			selectedSlab = createNewSlab(cachep);
 			if (selectedSlab == NULL) {
 				cachep->lastErrorCode = ERRCODE_NO_SPACE;
-				ReleaseMutex(cachep->mutex); //nema mesta za novi slab
+				lock_release(&cachep->mutex); //nema mesta za novi slab
 				return NULL;
 			}
 			cachep->canShrink = 0;
@@ -290,22 +675,27 @@ void* kmem_cache_alloc_trusted(kmem_cache_t* cachep) {
 
 		if (!(selectedSlab->freeObjectsLeft)) {
 			selectedSlab->nextSlab = cachep->fullSlabs;
-			if (cachep->fullSlabs != NULL)
-				cachep->fullSlabs->prevSlab = selectedSlab;
-			cachep->fullSlabs = selectedSlab;
+			if (cachep->fullSlabs != 0)
+				SLAB(cachep->fullSlabs)->prevSlab = OFFSET(selectedSlab);
+			cachep->fullSlabs = OFFSET(selectedSlab);
 		}
 
 		else {
 			selectedSlab->nextSlab = cachep->partialSlabs;
-			if (cachep->partialSlabs != NULL)
-				cachep->partialSlabs->prevSlab = selectedSlab;
-			cachep->partialSlabs = selectedSlab;
+			if (cachep->partialSlabs != 0)
+				SLAB(cachep->partialSlabs)->prevSlab = OFFSET(selectedSlab);
+			cachep->partialSlabs = OFFSET(selectedSlab);
 		}
 	}
 
+	if (cachep->ownerTags)
+		*getOwnerTag(cachep, selectedSlab, returnedObject) = ownerTag;
 	cachep->lastErrorCode = 0;
 
-	ReleaseMutex(cachep->mutex);
+	lock_release(&cachep->mutex);
+
+	if (profilerActive && cachep->aliasCount == 0 && !cachep->internal) //za zajednicki skup uzorak se pripisuje kesu koji ga deli
+		profiler_alloc(cachep->name, returnedObject, cachep->objectSize);
 
 	if (cachep->ctor != NULL)
 		cachep->ctor(returnedObject);
@@ -313,56 +703,63 @@ void* kmem_cache_alloc_trusted(kmem_cache_t* cachep) {
 	return returnedObject;
 }
 
+void* kmem_cache_alloc_trusted(kmem_cache_t* cachep) {
+	return allocSlabObject(cachep, 0);
+}
+
 void* kmem_cache_alloc(kmem_cache_t* cachep)
 {
 	if (slabAllocator == NULL || cachep == NULL) return NULL; //neispravan argument ili alokator nije inicijalizovan
 	
 	if (!cacheExists(cachep)) return NULL; //nevalidna adresa kesa
 
-	return kmem_cache_alloc_trusted(cachep);
+	void* retVal = kmem_cache_alloc_trusted(cachep);
+	if (tracerActive)
+		trace_event(TRACE_CACHE_ALLOC, cachep, retVal, 0, NULL);
+	return retVal;
 }
 
 int objectBelongsToSlab(kmem_cache_t* cachep, char* objp, SlabMetadata* slab) {
-	char* endAddress = slab->startingAddress + cachep->actualSize * cachep->objectsPerSlab;
-	if (objp < slab->startingAddress || objp >= endAddress) return 0;
-	unsigned distance = objp - slab->startingAddress;
+	char* startingAddress = POINTER(slab->startingAddress);
+	char* endAddress = startingAddress + cachep->actualSize * cachep->objectsPerSlab;
+	if (objp < startingAddress || objp >= endAddress) return 0;
+	size_t distance = objp - startingAddress;
 	
 	return distance % cachep->actualSize == 0;
 }
 
 SlabMetadata* getSlabWithObject(kmem_cache_t* cachep, char* objp) {
-	SlabMetadata* currSlab = cachep->partialSlabs;
+	SlabMetadata* currSlab = SLAB(cachep->partialSlabs);
 	while (currSlab != NULL) {
 		if (objectBelongsToSlab(cachep, objp, currSlab))
 			return currSlab;
-		currSlab = currSlab->nextSlab;
+		currSlab = SLAB(currSlab->nextSlab);
 	}
-	currSlab = cachep->fullSlabs;
+	currSlab = SLAB(cachep->fullSlabs);
 	while (currSlab != NULL) {
 		if (objectBelongsToSlab(cachep, objp, currSlab))
 			return currSlab;
-		currSlab = currSlab->nextSlab;
+		currSlab = SLAB(currSlab->nextSlab);
 	}
 	return NULL;
 }
 
 void freeOcupiedObject(kmem_cache_t* cachep, SlabMetadata* slab, char* objp) {
-	char** nextObject = objp;
+	ArenaOffset* nextObject = objp;
 	*nextObject = slab->freeList;
-	slab->freeList = objp;
+	slab->freeList = OFFSET(objp);
 	++(slab->freeObjectsLeft);
 	setOccupyBit(cachep, slab, objp, 0);
 }
 
-int kmem_cache_free_trusted(kmem_cache_t* cachep, void* objp) {
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) return -1; //kes je obrisan u medjuvremenu
-
+//brava kesa koji ima ploce mora biti zauzeta; u zajednickom skupu objekat mora pripadati kesu sa oznakom ownerTag
+int freeSlabObject(kmem_cache_t* cachep, void* objp, int ownerTag) {
 	SlabMetadata* slabWithObject = getSlabWithObject(cachep, objp);
-	if (slabWithObject == NULL || !getOccupyBit(cachep, slabWithObject, objp)) {
+	if (slabWithObject == NULL || !getOccupyBit(cachep, slabWithObject, objp)
+		|| (cachep->ownerTags && *getOwnerTag(cachep, slabWithObject, objp) != ownerTag)) {
 		//printf("ovaj objekat ne postoji\n");
 		cachep->lastErrorCode = ERRCODE_INVALID_OBJECT;
-		ReleaseMutex(cachep->mutex); //pokazivac ne pokazuje na zauzet objekat koji pripada kesu
-		return -1;
+		return -1; //pokazivac ne pokazuje na zauzet objekat koji pripada kesu
 	}
 
 	if (cachep->dtor != NULL)
@@ -370,122 +767,463 @@ int kmem_cache_free_trusted(kmem_cache_t* cachep, void* objp) {
 
 	freeOcupiedObject(cachep, slabWithObject, objp);
 
+	if (profilerLiveSamples > 0 && !cachep->internal)
+		profiler_free(objp);
+
 	//printf("preostalo objekata: %d\n", slabWithObject->freeObjectsLeft);
 
-	if (slabWithObject->freeObjectsLeft == cachep->objectsPerSlab || slabWithObject->freeObjectsLeft == cachep->objectsPerSlab - 1) {
+	if (slabWithObject->freeObjectsLeft == cachep->objectsPerSlab || slabWithObject->freeObjectsLeft == 1) { //ploca je bila puna ili je ostala prazna
 		//printf("izacuje se slab iz svoje liste\n");
-		if (slabWithObject->nextSlab != NULL)
-			slabWithObject->nextSlab->prevSlab = slabWithObject->prevSlab;
-		if (slabWithObject->prevSlab != NULL)
-			slabWithObject->prevSlab->nextSlab = slabWithObject->nextSlab;
-		else if (cachep->fullSlabs == slabWithObject)
+		if (slabWithObject->nextSlab != 0)
+			SLAB(slabWithObject->nextSlab)->prevSlab = slabWithObject->prevSlab;
+		if (slabWithObject->prevSlab != 0)
+			SLAB(slabWithObject->prevSlab)->nextSlab = slabWithObject->nextSlab;
+		else if (cachep->fullSlabs == OFFSET(slabWithObject))
 			cachep->fullSlabs = slabWithObject->nextSlab;
 		else
 			cachep->partialSlabs = slabWithObject->nextSlab;
 
-		slabWithObject->prevSlab = NULL;
+		slabWithObject->prevSlab = 0;
 
 		if (slabWithObject->freeObjectsLeft == cachep->objectsPerSlab) {
 			//printf("slab presao u slobodne\n");
 			slabWithObject->nextSlab = cachep->emptySlabs;
-			if (cachep->emptySlabs != NULL)
-				cachep->emptySlabs->prevSlab = slabWithObject;
-			cachep->emptySlabs = slabWithObject;
+			if (cachep->emptySlabs != 0)
+				SLAB(cachep->emptySlabs)->prevSlab = OFFSET(slabWithObject);
+			cachep->emptySlabs = OFFSET(slabWithObject);
 		}
 		else {
 			//printf("slab presao u parcijalne\n");
 			slabWithObject->nextSlab = cachep->partialSlabs;
-			if (cachep->partialSlabs != NULL)
-				cachep->partialSlabs->prevSlab = slabWithObject;
-			cachep->partialSlabs = slabWithObject;
+			if (cachep->partialSlabs != 0)
+				SLAB(cachep->partialSlabs)->prevSlab = OFFSET(slabWithObject);
+			cachep->partialSlabs = OFFSET(slabWithObject);
 		}
 	}
 
 	cachep->lastErrorCode = 0;
-	ReleaseMutex(cachep->mutex);
 	return 0;
 }
 
+int kmem_cache_free_trusted(kmem_cache_t* cachep, void* objp) {
+	if (!lock_acquire(&cachep->mutex)) return -1; //kes je obrisan u medjuvremenu
+
+	if (cachep->mergedInto != 0) {
+		kmem_cache_t* mergedPool = CACHE(cachep->mergedInto);
+		lock_acquire(&mergedPool->mutex);
+		int retVal = freeSlabObject(mergedPool, objp, cachep->ownerTag);
+		lock_release(&mergedPool->mutex);
+		if (!retVal) {
+			--(cachep->liveObjects);
+			cachep->lastErrorCode = 0;
+		}
+		else cachep->lastErrorCode = ERRCODE_INVALID_OBJECT;
+		lock_release(&cachep->mutex);
+		return retVal;
+	}
+
+	int retVal = freeSlabObject(cachep, objp, 0);
+	lock_release(&cachep->mutex);
+	return retVal;
+}
+
 void kmem_cache_free(kmem_cache_t* cachep, void* objp)
 {
 	if (slabAllocator == NULL || cachep == NULL || objp == NULL) return; //neispravan argument ili alokator nije inicijalizovan
 
 	if (!cacheExists(cachep)) return; //nevalidna adresa kesa
 
+	if (tracerActive)
+		trace_event(TRACE_CACHE_FREE, cachep, objp, 0, NULL); //pre oslobadjanja, da bi ponovna alokacija iste adrese bila snimljena posle
+
 	kmem_cache_free_trusted(cachep, objp);
 }
 
-void* kmalloc(size_t size)
+size_t kmem_cache_free_bulk(kmem_cache_t* cachep, size_t count, void** objs)
 {
-	if (slabAllocator == NULL || size == 0) return NULL; //neispravan argument ili alokator nije inicijalizovan
+	if (slabAllocator == NULL || cachep == NULL || objs == NULL) return 0; //neispravan argument ili alokator nije inicijalizovan
 
-	//printf("kmalloc size %d\n", size);
+	if (!cacheExists(cachep)) return 0; //nevalidna adresa kesa
 
-	int index = 0, needsBigger = 0;
-	while (size > 1) {
-		if (size & 1)
-			++needsBigger; //broj nije stepen dvojke
-		++index;
-		size >>= 1;
+	if (tracerActive)
+		for (size_t i = 0; i < count; i++)
+			if (objs[i] != NULL)
+				trace_event(TRACE_CACHE_FREE, cachep, objs[i], 0, NULL);
+
+	if (!lock_acquire(&cachep->mutex)) return 0; //kes je obrisan u medjuvremenu
+	kmem_cache_t* slabOwner = cachep->mergedInto != 0 ? CACHE(cachep->mergedInto) : cachep;
+	if (slabOwner != cachep)
+		lock_acquire(&slabOwner->mutex);
+
+	//brave se uzimaju jednom za ceo niz
+	size_t objectsFreed = 0;
+	int lastErrorCode = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (objs[i] == NULL) continue;
+		if (!freeSlabObject(slabOwner, objs[i], cachep->ownerTag)) ++objectsFreed;
+		else lastErrorCode = ERRCODE_INVALID_OBJECT;
 	}
-	if (needsBigger > 0) ++index;
-	size_t actualSize = 1 << index;
 
-	//printf("kmalloc actual size %d\n", actualSize);
+	if (slabOwner != cachep) {
+		cachep->liveObjects -= objectsFreed;
+		lock_release(&slabOwner->mutex);
+	}
+	cachep->lastErrorCode = lastErrorCode;
+	lock_release(&cachep->mutex);
+	return objectsFreed;
+}
 
-	//printf("indeks je %d\n", index);
-	if (index < MIN_DEG_SMALL || index > MAX_DEG_SMALL) { 
-		printf("oce to\n");
-		return NULL; } //nije u dozvoljenom opsegu velicina
+void kmem_cache_set_move(kmem_cache_t* cachep, int(*move)(void*, void*))
+{
+	if (slabAllocator == NULL || cachep == NULL) return; //neispravan argument ili alokator nije inicijalizovan
+
+	if (!cacheExists(cachep)) return; //nevalidna adresa kesa
+
+	if (slabAllocator->shared && move != NULL) return; //adresa funkcije iz deljene arene ne vazi u drugim procesima
+
+	if (!lock_acquire(&cachep->mutex)) return; //kes je obrisan u medjuvremenu
+	cachep->move = move;
+	lock_release(&cachep->mutex);
+}
+
+void removeSlab(ArenaOffset* list, SlabMetadata* slab) {
+	if (slab->nextSlab != 0)
+		SLAB(slab->nextSlab)->prevSlab = slab->prevSlab;
+	if (slab->prevSlab != 0)
+		SLAB(slab->prevSlab)->nextSlab = slab->nextSlab;
+	else
+		*list = slab->nextSlab;
+	slab->prevSlab = slab->nextSlab = 0;
+}
+
+void pushSlab(ArenaOffset* list, SlabMetadata* slab) {
+	slab->prevSlab = 0;
+	slab->nextSlab = *list;
+	if (*list != 0)
+		SLAB(*list)->prevSlab = OFFSET(slab);
+	*list = OFFSET(slab);
+}
+
+//najredja parcijalna ploca, ako ostale parcijalne ploce mogu da prime sve njene objekte
+SlabMetadata* getSparsestSlab(kmem_cache_t* cachep) {
+	SlabMetadata* sparsest = NULL;
+	int freeSlots = 0;
+	SlabMetadata* currSlab = SLAB(cachep->partialSlabs);
+	while (currSlab != NULL) {
+		freeSlots += currSlab->freeObjectsLeft;
+		if (sparsest == NULL || currSlab->freeObjectsLeft > sparsest->freeObjectsLeft)
+			sparsest = currSlab;
+		currSlab = SLAB(currSlab->nextSlab);
+	}
+	if (sparsest == NULL) return NULL;
+
+	int liveObjects = cachep->objectsPerSlab - sparsest->freeObjectsLeft;
+	return freeSlots - sparsest->freeObjectsLeft >= liveObjects ? sparsest : NULL;
+}
+
+SlabMetadata* getFullestSlab(kmem_cache_t* cachep) {
+	SlabMetadata* fullest = NULL;
+	SlabMetadata* currSlab = SLAB(cachep->partialSlabs);
+	while (currSlab != NULL) {
+		if (fullest == NULL || currSlab->freeObjectsLeft < fullest->freeObjectsLeft)
+			fullest = currSlab;
+		currSlab = SLAB(currSlab->nextSlab);
+	}
+	return fullest;
+}
 
+//premesta sve zive objekte ploce u najpunije parcijalne ploce; vraca 0 ako move odbije premestanje
+int drainSlab(kmem_cache_t* cachep, SlabMetadata* source) {
+	removeSlab(&cachep->partialSlabs, source); //izvor ne sme biti izabran kao odrediste
+
+	char* startingAddress = POINTER(source->startingAddress);
+	unsigned char* occupyBits = POINTER(source->occupyBits);
+	for (int i = 0; i < cachep->objectsPerSlab; i++) {
+		if (occupyBits[i / 8] == 0) {
+			i += 7 - i % 8; //ceo bajt je slobodan
+			continue;
+		}
+		if (!(occupyBits[i / 8] & (1 << (i % 8)))) continue;
+
+		SlabMetadata* destination = getFullestSlab(cachep);
+		char* from = startingAddress + i * cachep->actualSize;
+		char* to = getFreeObject(cachep, destination);
+		memcpy(to, from, cachep->objectSize);
+		if (!cachep->move(from, to)) {
+			freeOcupiedObject(cachep, destination, to);
+			pushSlab(&cachep->partialSlabs, source);
+			return 0; //objekat ne sme da se premesti
+		}
+		freeOcupiedObject(cachep, source, from);
+
+		if (profilerLiveSamples > 0)
+			profiler_move(from, to); //uzorak prati objekat na novu adresu
+
+		if (destination->freeObjectsLeft == 0) {
+			removeSlab(&cachep->partialSlabs, destination);
+			pushSlab(&cachep->fullSlabs, destination);
+		}
+	}
+	pushSlab(&cachep->emptySlabs, source);
+	return 1;
+}
+
+int kmem_cache_compact(kmem_cache_t* cachep)
+{
+	if (slabAllocator == NULL || cachep == NULL) return 0; //neispravan argument ili alokator nije inicijalizovan
+
+	if (!cacheExists(cachep)) return 0; //nevalidna adresa kesa
+
+	if (!lock_acquire(&cachep->mutex)) return 0; //kes je obrisan u medjuvremenu
+	if (cachep->move == NULL || cachep->mergedInto != 0) {
+		lock_release(&cachep->mutex);
+		return 0; //sazimanje nije dozvoljeno, ili ploce dele kesevi sa razlicitim objektima
+	}
+
+	int slabsBefore = cachep->numberOfSlabs;
+	SlabMetadata* source;
+	while ((source = getSparsestSlab(cachep)) != NULL && drainSlab(cachep, source));
+
+	cachep->canShrink = 1;
+	kmem_cache_shrink_trusted(cachep); //ispraznjene ploce se vracaju buddy alokatoru
+	int blocksFreed = (slabsBefore - cachep->numberOfSlabs) * cachep->slabSizeInBlocks;
+	lock_release(&cachep->mutex);
+	return blocksFreed;
+}
+
+kmem_cache_t* getLargeBufferCache() {
+	lock_acquire(&slabAllocator->mutex);
+	if (slabAllocator->largeBufferCache == 0) {
+		kmem_cache_t* cache = kmem_cache_alloc_trusted(&slabAllocator->cacheCache);
+		if (cache != NULL) {
+			cache->prevCache = cache->nextCache = 0;
+			setCacheFields(cache, sizeof(LargeBuffer), 1, LARGE_BUFFER_DESC_NAME, NULL, NULL, 0);
+			cache->internal = 1;
+			slabAllocator->largeBufferCache = OFFSET(cache);
+		}
+	}
+	lock_release(&slabAllocator->mutex);
+	return CACHE(slabAllocator->largeBufferCache);
+}
+
+LargeBuffer* findLargeBuffer(const void* objp) {
+	LargeBuffer* currBuffer = LARGE(slabAllocator->largeBuffers);
+	while (currBuffer != NULL && POINTER(currBuffer->address) != objp)
+		currBuffer = LARGE(currBuffer->next);
+	return currBuffer;
+}
+
+void* kmallocLarge(size_t size) {
+	kmem_cache_t* descriptorCache = getLargeBufferCache();
+	if (descriptorCache == NULL) return NULL; //nema prostora za kes opisa
+
+	LargeBuffer* descriptor = kmem_cache_alloc_trusted(descriptorCache);
+	if (descriptor == NULL) return NULL; //nema prostora za opis
+
+	lock_acquire(&slabAllocator->mutex);
+	void* buffer = buddy_take(buddyAllocator, size);
+	if (buffer == NULL) {
+		lock_release(&slabAllocator->mutex);
+		kmem_cache_free_trusted(descriptorCache, descriptor);
+		return NULL; //nema prostora
+	}
+	descriptor->address = OFFSET(buffer);
+	descriptor->size = buddy_chunk_size(size);
+	descriptor->prev = 0;
+	descriptor->next = slabAllocator->largeBuffers;
+	if (slabAllocator->largeBuffers != 0)
+		LARGE(slabAllocator->largeBuffers)->prev = OFFSET(descriptor);
+	slabAllocator->largeBuffers = OFFSET(descriptor);
+	lock_release(&slabAllocator->mutex);
+
+	if (profilerActive)
+		profiler_alloc(LARGE_BUFFER_NAME, buffer, descriptor->size);
+
+	return buffer;
+}
+
+void* kmallocClass(int index) {
+	size_t actualSize = (size_t) 1 << index;
 	index -= MIN_DEG_SMALL;
 	//printf("tj indeks je %d\n", index);
 
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
-	if (slabAllocator->smallBufferCaches[index] == NULL) {
+	lock_acquire(&slabAllocator->mutex);
+	if (slabAllocator->smallBufferCaches[index] == 0) {
 		//printf("kmalloc (%d)\n", index);
-		kmem_cache_t* cache = buddy_take(slabAllocator->buddy, sizeof(kmem_cache_t));
+		kmem_cache_t* cache = kmem_cache_alloc_trusted(&slabAllocator->cacheCache);
 		if (cache == NULL) {
-			ReleaseMutex(slabAllocator->mutex);
+			lock_release(&slabAllocator->mutex);
 			return NULL; //nema prostora
 		}
-		cache->prevCache = cache->nextCache = NULL;
+		cache->prevCache = cache->nextCache = 0;
 		char name[MAX_NAME_LENGTH] = "size-", numBuf[MAX_NAME_LENGTH];
 		_itoa_s(actualSize,numBuf,MAX_NAME_LENGTH,10);
 		strcat_s(name, MAX_NAME_LENGTH,numBuf);
-		setCacheFields(cache, actualSize, name, NULL, NULL);
+		setCacheFields(cache, actualSize, actualSize < CACHE_L1_LINE_SIZE ? actualSize : CACHE_L1_LINE_SIZE, name, NULL, NULL, 0); //bafer je poravnat na svoju velicinu, najvise na liniju kesa
 		//printf("ime malog buffera: %s\n", name);
 		//printf("VELICINA SLABA JE %d\n", cache->slabSizeInBlocks);
-		slabAllocator->smallBufferCaches[index] = cache;
+		slabAllocator->smallBufferCaches[index] = OFFSET(cache);
+	}
+	lock_release(&slabAllocator->mutex);
+
+	return kmem_cache_alloc_trusted(CACHE(slabAllocator->smallBufferCaches[index]));
+}
+
+void* kmalloc(size_t size)
+{
+	if (slabAllocator == NULL || size == 0) return NULL; //neispravan argument ili alokator nije inicijalizovan
+
+	//printf("kmalloc size %d\n", size);
+	size_t requestedSize = size;
+
+	int index = 0, needsBigger = 0;
+	while (size > 1) {
+		if (size & 1)
+			++needsBigger; //broj nije stepen dvojke
+		++index;
+		size >>= 1;
+	}
+	if (needsBigger > 0) ++index;
+
+	//printf("indeks je %d\n", index);
+	if (index > MAX_DEG_SMALL) {
+		void* retVal = kmallocLarge(requestedSize); //veliki baferi se uzimaju direktno od buddy alokatora
+		if (tracerActive)
+			trace_event(TRACE_KMALLOC, NULL, retVal, requestedSize, NULL);
+		return retVal;
 	}
-	ReleaseMutex(slabAllocator->mutex);
+	if (index < MIN_DEG_SMALL) { 
+		printf("oce to\n");
+		return NULL; } //nije u dozvoljenom opsegu velicina
 
-	return kmem_cache_alloc_trusted(slabAllocator->smallBufferCaches[index]);
+	void* retVal = kmallocClass(index);
+	if (tracerActive)
+		trace_event(TRACE_KMALLOC, NULL, retVal, requestedSize, NULL);
+	return retVal;
+}
 
+void* kmalloc_class(int deg)
+{
+	if (slabAllocator == NULL || deg < MIN_DEG_SMALL || deg > MAX_DEG_SMALL) return NULL; //neispravan argument ili alokator nije inicijalizovan
+
+	void* retVal = kmallocClass(deg);
+	if (tracerActive)
+		trace_event(TRACE_KMALLOC, NULL, retVal, (size_t) 1 << deg, NULL);
+	return retVal;
 }
 
 void kfree(const void* objp)
 {
 	if (slabAllocator == NULL || objp == NULL) return NULL; //neispravan argument ili alokator nije inicijalizovan
 
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
+	if (tracerActive)
+		trace_event(TRACE_KFREE, NULL, objp, 0, NULL);
+
+	lock_acquire(&slabAllocator->mutex);
 	for (int i = 0; i < MAX_DEG_SMALL - MIN_DEG_SMALL + 1; i++) {
-		if (slabAllocator->smallBufferCaches[i] != NULL) {
-			ReleaseMutex(slabAllocator->mutex);
-			if (!kmem_cache_free_trusted(slabAllocator->smallBufferCaches[i], objp)) {
-				WaitForSingleObject(slabAllocator->smallBufferCaches[i]->mutex,INFINITE);
-				if ((++(slabAllocator->smallBufferCaches[i]->deallocCount)) == slabAllocator->smallBufferCaches[i]->objectsPerSlab) {
+		kmem_cache_t* cache = CACHE(slabAllocator->smallBufferCaches[i]);
+		if (cache != NULL) {
+			lock_release(&slabAllocator->mutex);
+			if (!kmem_cache_free_trusted(cache, objp)) {
+				lock_acquire(&cache->mutex);
+				if ((++(cache->deallocCount)) == cache->objectsPerSlab) {
 					//printf("vreme je za brisanje\n");
-					kmem_cache_shrink_trusted(slabAllocator->smallBufferCaches[i]);
-					slabAllocator->smallBufferCaches[i]->deallocCount = 0;
+					kmem_cache_shrink_trusted(cache);
+					cache->deallocCount = 0;
 				}
-				ReleaseMutex(slabAllocator->smallBufferCaches[i]->mutex);
+				lock_release(&cache->mutex);
 				return;
 			}
-			else WaitForSingleObject(slabAllocator->mutex, INFINITE);
+			else lock_acquire(&slabAllocator->mutex);
 		}
 	}
-	ReleaseMutex(slabAllocator->mutex);
+
+	LargeBuffer* descriptor = findLargeBuffer(objp);
+	if (descriptor != NULL) {
+		if (descriptor->next != 0)
+			LARGE(descriptor->next)->prev = descriptor->prev;
+		if (descriptor->prev != 0)
+			LARGE(descriptor->prev)->next = descriptor->next;
+		else
+			slabAllocator->largeBuffers = descriptor->next;
+
+		if (profilerLiveSamples > 0)
+			profiler_free(objp);
+		buddy_give(buddyAllocator, POINTER(descriptor->address), descriptor->size);
+	}
+	lock_release(&slabAllocator->mutex);
+
+	if (descriptor != NULL)
+		kmem_cache_free_trusted(CACHE(slabAllocator->largeBufferCache), descriptor);
+}
+
+kmem_cache_t* getSmallBufferCache(const void* objp) {
+	void* object = (void*) objp; //pomocne funkcije ploce ne menjaju objekat
+	for (int i = 0; i < MAX_DEG_SMALL - MIN_DEG_SMALL + 1; i++) {
+		kmem_cache_t* cache = CACHE(slabAllocator->smallBufferCaches[i]);
+		if (cache == NULL) continue;
+
+		lock_acquire(&cache->mutex);
+		SlabMetadata* slab = getSlabWithObject(cache, object);
+		int owned = slab != NULL && getOccupyBit(cache, slab, object);
+		lock_release(&cache->mutex);
+		if (owned) return cache;
+	}
+	return NULL;
+}
+
+size_t kmalloc_usable_size(const void* objp)
+{
+	if (slabAllocator == NULL || objp == NULL) return 0; //neispravan argument ili alokator nije inicijalizovan
+
+	kmem_cache_t* cache = getSmallBufferCache(objp);
+	if (cache != NULL) return cache->objectSize;
+
+	lock_acquire(&slabAllocator->mutex);
+	LargeBuffer* descriptor = findLargeBuffer(objp);
+	size_t size = descriptor != NULL ? descriptor->size : 0;
+	lock_release(&slabAllocator->mutex);
+	return size;
+}
+
+int growLargeBuffer(const void* objp, size_t size) {
+	lock_acquire(&slabAllocator->mutex);
+	LargeBuffer* descriptor = findLargeBuffer(objp);
+	int grown = descriptor != NULL && buddy_grow(buddyAllocator, POINTER(descriptor->address), descriptor->size, size);
+	if (grown)
+		descriptor->size = buddy_chunk_size(size);
+	lock_release(&slabAllocator->mutex);
+
+	if (grown && profilerLiveSamples > 0)
+		profiler_resize(objp, buddy_chunk_size(size)); //uzorak prati novu velicinu bafera
+	return grown;
+}
+
+void* krealloc(const void* objp, size_t size)
+{
+	if (slabAllocator == NULL) return NULL; //alokator nije inicijalizovan
+	if (objp == NULL) return kmalloc(size);
+	if (size == 0) {
+		kfree(objp);
+		return NULL;
+	}
+
+	void* buffer = (void*) objp; //bafer ostaje isti, pozivaocu se vraca kao promenljiv
+	size_t usableSize = kmalloc_usable_size(objp);
+	if (usableSize == 0) return NULL; //pokazivac ne pokazuje na zauzet bafer
+	if (size <= usableSize) return buffer; //staje u postojecu klasu velicine
+
+	if (usableSize > ((size_t) 1 << MAX_DEG_SMALL) && growLargeBuffer(objp, size)) {
+		if (tracerActive)
+			trace_event(TRACE_KREALLOC, NULL, objp, size, NULL);
+		return buffer; //pripojen slobodan buddy partner
+	}
+
+	void* newObject = kmalloc(size);
+	if (newObject == NULL) return NULL; //stari bafer ostaje netaknut
+	memcpy(newObject, objp, usableSize);
+	kfree(objp);
+	return newObject;
 }
 
 void kmem_cache_destroy(kmem_cache_t* cachep)
@@ -493,35 +1231,51 @@ void kmem_cache_destroy(kmem_cache_t* cachep)
 	if (slabAllocator == NULL || cachep == NULL) return; //neispravan argument ili neinicijalizovan alokator
 	
 	if (!cacheExists(cachep)) return;	//nevalidna adresa kesa
+
+	if (tracerActive)
+		trace_event(TRACE_CACHE_DESTROY, cachep, NULL, 0, NULL);
+
+	//dopuna uzima bravu kesa, pa se na njen kraj ceka pre nego sto se brava kesa uzme
+	lock_acquire(&slabAllocator->mutex);
+	int reserveSlabs = cachep->reserveSlabs;
+	stopRefill(cachep);
+	lock_release(&slabAllocator->mutex);
 	
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) return; //kes je obrisan u medjuvremenu
+	if (!lock_acquire(&cachep->mutex)) return; //kes je obrisan u medjuvremenu
 
-	if (cachep->partialSlabs != NULL || cachep->fullSlabs != NULL) {
+	if (cachep->partialSlabs != 0 || cachep->fullSlabs != 0 || cachep->liveObjects > 0) {
 		//printf("Kes nije prazan\n");
+		cachep->reserveSlabs = reserveSlabs; //kes ostaje, pa i njegova rezerva
+		if (reserveSlabs > 0)
+			requestRefill(cachep);
 		cachep->lastErrorCode = ERRCODE_CACHE_NOT_EMPTY;
-		ReleaseMutex(cachep->mutex); //kes sadrzi objekte
+		lock_release(&cachep->mutex); //kes sadrzi objekte
 		return;
 	}
 
-	WaitForSingleObject(slabAllocator->mutex, INFINITE);
-	if (cachep->nextCache != NULL)
-		cachep->nextCache->prevCache = cachep->prevCache;
-	if (cachep->prevCache != NULL)
-		cachep->prevCache->nextCache = cachep->nextCache;
+	lock_acquire(&slabAllocator->mutex);
+	if (cachep->nextCache != 0)
+		CACHE(cachep->nextCache)->prevCache = cachep->prevCache;
+	if (cachep->prevCache != 0)
+		CACHE(cachep->prevCache)->nextCache = cachep->nextCache;
 	else
 		slabAllocator->cacheList = cachep->nextCache;
 	
-	CloseHandle(cachep->mutex);
+	lock_destroy(&cachep->mutex);
 
-	SlabMetadata* currSlab = cachep->emptySlabs;
+	SlabMetadata* currSlab = SLAB(cachep->emptySlabs);
 	while (currSlab != NULL) {
+		SlabMetadata* nextSlab = SLAB(currSlab->nextSlab);
 		//printf("kmem_cache_destroy (slab) (%s)\n", cachep->name);
-		buddy_give(slabAllocator->buddy, currSlab, cachep->slabSizeInBlocks * BLOCK_SIZE);
-		currSlab = currSlab->nextSlab;
+		buddy_give(buddyAllocator, currSlab, (size_t) cachep->slabSizeInBlocks * BLOCK_SIZE);
+		currSlab = nextSlab;
 	}
 	//printf("kmem_cache_destroy (cache) (%s)\n", cachep->name);
-	buddy_give(slabAllocator -> buddy, cachep, sizeof(kmem_cache_t));
-	ReleaseMutex(slabAllocator->mutex);
+	kmem_cache_t* mergedPool = CACHE(cachep->mergedInto);
+	kmem_cache_free_trusted(&slabAllocator->cacheCache, cachep);
+	if (mergedPool != NULL && --(mergedPool->aliasCount) == 0)
+		destroyMergedPool(mergedPool); //poslednji kes koji je delio skup
+	lock_release(&slabAllocator->mutex);
 
 }
 
@@ -537,37 +1291,77 @@ void kmem_cache_info(kmem_cache_t* cachep)
 		return;
 	}
 
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) {
+	if (!lock_acquire(&cachep->mutex)) {
 		printf("Trazeni kes ne postoji!\n");
 		return;
 	} //kes je obrisan u medjuvremenu
 
+	kmem_cache_t* slabSource = cachep;
+	if (cachep->mergedInto != 0) {
+		slabSource = CACHE(cachep->mergedInto);
+		printf("Ime: %s ; Velicina jednog podatka: %zu ; Broj objekata: %d ; Deli ploce sa: %s (%d keseva)\n", cachep->name,
+			cachep->objectSize, cachep->liveObjects, slabSource->name, slabSource->aliasCount);
+		lock_acquire(&slabSource->mutex);
+	}
+
 	int totalSlots = 0, usedSlots = 0;
 
-	SlabMetadata* currSlab = cachep->emptySlabs;
+	SlabMetadata* currSlab = SLAB(slabSource->emptySlabs);
 
 	while (currSlab != NULL) {
-		totalSlots += cachep->objectsPerSlab;
-		currSlab = currSlab->nextSlab;
+		totalSlots += slabSource->objectsPerSlab;
+		currSlab = SLAB(currSlab->nextSlab);
 	}
 	
-	currSlab = cachep->partialSlabs;
+	currSlab = SLAB(slabSource->partialSlabs);
 	while (currSlab != NULL) {
-		totalSlots += cachep->objectsPerSlab;
-		usedSlots += cachep->objectsPerSlab - currSlab->freeObjectsLeft;
-		currSlab = currSlab->nextSlab;
+		totalSlots += slabSource->objectsPerSlab;
+		usedSlots += slabSource->objectsPerSlab - currSlab->freeObjectsLeft;
+		currSlab = SLAB(currSlab->nextSlab);
 	}
 
-	currSlab = cachep->fullSlabs;
+	currSlab = SLAB(slabSource->fullSlabs);
 	while (currSlab != NULL) {
-		totalSlots += cachep->objectsPerSlab;
-		usedSlots += cachep->objectsPerSlab;
-		currSlab = currSlab->nextSlab;
+		totalSlots += slabSource->objectsPerSlab;
+		usedSlots += slabSource->objectsPerSlab;
+		currSlab = SLAB(currSlab->nextSlab);
 	}
 	
-	printf("Ime: %s ; Velicina jednog podatka: %d ; Velicina kesa u blokovima: %d\n", cachep->name, cachep->objectSize, cachep->slabSizeInBlocks*cachep->numberOfSlabs + 1);
-	printf("Broj ploca: %d ; Broj objekata po ploci: %d ; Popunjenost : %f%% (%d/%d)\n", cachep->numberOfSlabs, cachep->objectsPerSlab, (double) usedSlots / (totalSlots == 0 ? 1 : totalSlots) * 100 , usedSlots, totalSlots);
-	ReleaseMutex(cachep->mutex);
+	printf("Ime: %s ; Velicina jednog podatka: %zu ; Velicina kesa u blokovima: %d\n", slabSource->name, slabSource->objectSize, slabSource->slabSizeInBlocks*slabSource->numberOfSlabs);
+	printf("Broj ploca: %d ; Broj objekata po ploci: %d ; Popunjenost : %f%% (%d/%d)\n", slabSource->numberOfSlabs, slabSource->objectsPerSlab, (double) usedSlots / (totalSlots == 0 ? 1 : totalSlots) * 100 , usedSlots, totalSlots);
+	if (slabSource->reserveSlabs > 0 || slabSource->reserveMisses > 0)
+		printf("Rezerva praznih ploca: %d ; Alokacija mimo rezerve: %d\n", slabSource->reserveSlabs, slabSource->reserveMisses);
+	if (slabSource != cachep)
+		lock_release(&slabSource->mutex);
+	lock_release(&cachep->mutex);
+}
+
+void kmem_arena_stats(BuddyStats* stats)
+{
+	if (slabAllocator == NULL || stats == NULL) return; //neispravan argument ili neinicijalizovan alokator
+
+	lock_acquire(&slabAllocator->mutex);
+	buddy_get_stats(buddyAllocator, stats);
+	lock_release(&slabAllocator->mutex);
+}
+
+void* kmem_chunk_take(size_t size)
+{
+	if (slabAllocator == NULL || size == 0) return NULL; //neispravan argument ili neinicijalizovan alokator
+
+	lock_acquire(&slabAllocator->mutex);
+	void* chunk = buddy_take(buddyAllocator, size);
+	lock_release(&slabAllocator->mutex);
+	return chunk;
+}
+
+void kmem_chunk_give(void* chunk, size_t size)
+{
+	if (slabAllocator == NULL || chunk == NULL) return; //neispravan argument ili neinicijalizovan alokator
+
+	lock_acquire(&slabAllocator->mutex);
+	buddy_give(buddyAllocator, chunk, size);
+	lock_release(&slabAllocator->mutex);
 }
 
 int kmem_cache_error(kmem_cache_t* cachep)
@@ -576,9 +1370,9 @@ int kmem_cache_error(kmem_cache_t* cachep)
 	
 	if (!cacheExists(cachep)) return ERRCODE_INVALID_CACHE;
 
-	if (WaitForSingleObject(cachep->mutex, INFINITE) != WAIT_OBJECT_0) return ERRCODE_INVALID_CACHE; //kes je obrisan u medjuvremenu
+	if (!lock_acquire(&cachep->mutex)) return ERRCODE_INVALID_CACHE; //kes je obrisan u medjuvremenu
 	
 	int retVal = cachep->lastErrorCode;
-	ReleaseMutex(cachep->mutex);
+	lock_release(&cachep->mutex);
 	return retVal;
 }
\ No newline at end of file
@@ -4,16 +4,33 @@
 
 typedef struct kmem_cache_s kmem_cache_t;
 
+//velicina bloka se moze zadati pri prevodjenju, npr. 2MB za arene u velikim stranicama
+#ifndef BLOCK_SIZE
 #define BLOCK_SIZE (4096)
+#endif
 #define CACHE_L1_LINE_SIZE (64)
 
-void kmem_init(void* space, int block_num);
+void kmem_init(void* space, size_t block_num);
+void kmem_init_shared(void* space, size_t block_num); // Initialize allocator in memory shared between processes (caches there cannot have ctor, dtor, move or reserve)
+int kmem_attach(void* space); // Use allocator initialized by another process, possibly mapped at another address
 kmem_cache_t* kmem_cache_create(const char* name, size_t size, void (*ctor)(void*), void (*dtor)(void*)); // Allocate cache
+kmem_cache_t* kmem_cache_create_aligned(const char* name, size_t size, size_t align, void (*ctor)(void*), void (*dtor)(void*)); // Allocate cache whose objects are aligned to align (power of two, at most BLOCK_SIZE)
+kmem_cache_t* kmem_cache_find(const char* name); // Find cache by name, e.g. one created by another process
 int kmem_cache_shrink(kmem_cache_t* cachep); // Shrink cache
+void kmem_cache_set_move(kmem_cache_t* cachep, int (*move)(void* from, void* to)); // Allow compaction; move fixes references, returns 0 to keep the object
+int kmem_cache_compact(kmem_cache_t* cachep); // Move objects out of sparse slabs and release them
 void* kmem_cache_alloc(kmem_cache_t* cachep); // Allocate one object from cache
+int kmem_cache_reserve(kmem_cache_t* cachep, int n_objects); // Keep empty slabs for n_objects, refilled in the background (returns 0 in a shared arena)
 void kmem_cache_free(kmem_cache_t* cachep, void* objp); // Deallocate one object from cache
+size_t kmem_cache_free_bulk(kmem_cache_t* cachep, size_t count, void** objs); // Deallocate count objects under one cache lock, returns number freed
 void* kmalloc(size_t size); // Alloacate one small memory buffer
+void* kmalloc_class(int deg); // Allocate one small memory buffer of size 2^deg, skipping size class lookup
 void kfree(const void* objp); // Deallocate one small memory buffer
+void* krealloc(const void* objp, size_t size); // Resize one memory buffer, in place when possible
+size_t kmalloc_usable_size(const void* objp); // Usable size of one memory buffer
 void kmem_cache_destroy(kmem_cache_t* cachep); // Deallocate cache
 void kmem_cache_info(kmem_cache_t* cachep); // Print cache info
-int kmem_cache_error(kmem_cache_t* cachep); // Print error message
\ No newline at end of file
+int kmem_cache_error(kmem_cache_t* cachep); // Print error message
+void kmem_cache_set_merging(int enabled); // Let caches created afterwards share slabs with compatible caches
+size_t kmem_offset(const void* objp); // Position of an object within the arena, valid in every process
+void* kmem_pointer(size_t offset); // Address of an object in this process, from kmem_offset
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+// File: slab.hpp
+extern "C" {
+#include "slab.h"
+#include "slab_structs.h"
+}
+#include <cstddef>
+#include <new>
+#include <typeinfo>
+#include <utility>
+
+//stepen klase velicine za kmalloc, racuna se u vreme prevodjenja kada je velicina konstanta
+//velicine iznad najvece klase daju MAX_DEG_SMALL + 1, polovina se zaokruzuje bez size + 1 koje prelazi preko nule
+constexpr int kmem_size_class(std::size_t size) {
+	return size <= (std::size_t(1) << MIN_DEG_SMALL) ? MIN_DEG_SMALL
+		: size > (std::size_t(1) << MAX_DEG_SMALL) ? MAX_DEG_SMALL + 1
+		: 1 + kmem_size_class(size / 2 + (size & 1));
+}
+
+template <std::size_t Size>
+inline void* kmalloc_fixed() {
+	static_assert(Size > 0, "kmalloc_fixed: size must be positive");
+	return kmem_size_class(Size) <= MAX_DEG_SMALL ? kmalloc_class(kmem_size_class(Size)) : kmalloc(Size);
+}
+
+//mali baferi su poravnati na svoju klasu velicine, najvise CACHE_L1_LINE_SIZE; veliki baferi samo koliko i pocetak arene,
+//pa se njihovo poravnanje proverava u vreme izvrsavanja
+inline void* kmem_check_alignment(void* objp, std::size_t align) {
+	if (objp != nullptr && reinterpret_cast<std::size_t>(objp) % align != 0) {
+		kfree(objp);
+		return nullptr;
+	}
+	return objp;
+}
+
+template <typename T>
+inline T* kmalloc_typed() {
+	static_assert(alignof(T) <= CACHE_L1_LINE_SIZE, "kmalloc_typed: kmalloc cannot align this type");
+	return static_cast<T*>(kmem_check_alignment(kmalloc_fixed<sizeof(T)>(), alignof(T)));
+}
+
+template <typename T>
+class kmem_cache {
+	static_assert(alignof(T) <= BLOCK_SIZE, "kmem_cache: slab cannot align this type");
+
+public:
+	explicit kmem_cache(const char* name, void (*ctor)(void*) = nullptr, void (*dtor)(void*) = nullptr)
+		: cache(kmem_cache_create_aligned(name, sizeof(T), alignof(T), ctor, dtor)) {
+		if (cache == nullptr) throw std::bad_alloc();
+	}
+
+	~kmem_cache() {
+		if (cache != nullptr) kmem_cache_destroy(cache);
+	}
+
+	kmem_cache(const kmem_cache&) = delete;
+	kmem_cache& operator=(const kmem_cache&) = delete;
+
+	kmem_cache(kmem_cache&& other) noexcept : cache(other.cache) {
+		other.cache = nullptr;
+	}
+
+	kmem_cache& operator=(kmem_cache&& other) noexcept {
+		if (this != &other) {
+			if (cache != nullptr) kmem_cache_destroy(cache);
+			cache = other.cache;
+			other.cache = nullptr;
+		}
+		return *this;
+	}
+
+	T* allocate() {
+		void* objp = kmem_cache_alloc(cache);
+		if (objp == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(objp);
+	}
+
+	void deallocate(T* objp) {
+		kmem_cache_free(cache, objp);
+	}
+
+	template <typename... Args>
+	T* create(Args&&... args) {
+		T* objp = allocate();
+		try {
+			return new (objp) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			deallocate(objp);
+			throw;
+		}
+	}
+
+	void destroy(T* objp) {
+		if (objp == nullptr) return;
+		objp->~T();
+		deallocate(objp);
+	}
+
+	int shrink() { return kmem_cache_shrink(cache); }
+	int compact() { return kmem_cache_compact(cache); }
+	void info() const { kmem_cache_info(cache); }
+	int error() const { return kmem_cache_error(cache); }
+	kmem_cache_t* get() const { return cache; }
+
+private:
+	kmem_cache_t* cache;
+};
+
+//cvorovi (n == 1) idu u kes svog tipa, nizovi u kmalloc
+template <typename T>
+class kmem_allocator {
+	static_assert(alignof(T) <= CACHE_L1_LINE_SIZE, "kmem_allocator: kmalloc cannot align this type");
+
+public:
+	typedef T value_type;
+
+	kmem_allocator() noexcept {}
+	template <typename U>
+	kmem_allocator(const kmem_allocator<U>&) noexcept {}
+
+	T* allocate(std::size_t n) {
+		if (n > static_cast<std::size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+
+		void* objp;
+		if (n == 1)
+			objp = kmem_cache_alloc(type_cache());
+		else {
+			std::size_t size = n * sizeof(T);
+			objp = kmem_size_class(size) <= MAX_DEG_SMALL ? kmalloc_class(kmem_size_class(size)) : kmem_check_alignment(kmalloc(size), alignof(T));
+		}
+		if (objp == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(objp);
+	}
+
+	void deallocate(T* objp, std::size_t n) noexcept {
+		if (n == 1)
+			kmem_cache_free(type_cache(), objp);
+		else
+			kfree(objp);
+	}
+
+	//kes se pravi pri prvoj alokaciji i ne unistava se, jer alokator moze nestati pre staticnih destruktora
+	static kmem_cache_t* type_cache() {
+		static kmem_cache_t* const cache = create_type_cache();
+		return cache;
+	}
+
+private:
+	static kmem_cache_t* create_type_cache() {
+		char name[MAX_NAME_LENGTH];
+		const char* typeName = typeid(T).name();
+		int i = 0;
+		for (; i < MAX_NAME_LENGTH - 1 && typeName[i] != 0; i++)
+			name[i] = typeName[i];
+		name[i] = 0;
+		return kmem_cache_create_aligned(name, sizeof(T), alignof(T), nullptr, nullptr);
+	}
+};
+
+template <typename T, typename U>
+inline bool operator==(const kmem_allocator<T>&, const kmem_allocator<U>&) noexcept { return true; }
+
+template <typename T, typename U>
+inline bool operator!=(const kmem_allocator<T>&, const kmem_allocator<U>&) noexcept { return false; }
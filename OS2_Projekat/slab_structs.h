@@ -4,6 +4,10 @@
 #define MAX_NAME_LENGTH 32
 #define MIN_DEG_SMALL 5
 #define MAX_DEG_SMALL 17
+#define MAX_OWNER_TAG 255
+#define LARGE_BUFFER_NAME "size-large"
+#define LARGE_BUFFER_DESC_NAME "large-buffers"
+#define CACHE_CACHE_NAME "kmem_cache"
 
 #define ERRCODE_NO_SPACE -1
 #define ERRCODE_INVALID_OBJECT -2
@@ -12,4 +16,6 @@
 
 typedef struct slab_alloc_metadata SlabAllocMetadata;
 
-typedef struct slab_metadata SlabMetadata;
\ No newline at end of file
+typedef struct slab_metadata SlabMetadata;
+
+typedef struct large_buffer LargeBuffer;
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "trace.h"
+#include "slab_structs.h"
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+
+#define TRACE_BUFFER_SIZE (1 << 16)
+
+volatile int tracerActive = 0;
+
+FILE* traceFile = NULL;
+HANDLE traceMutex = NULL;
+volatile LONG traceInitState = 0; //0 - nije inicijalizovan, 1 - inicijalizacija u toku, 2 - inicijalizovan
+
+int kmem_trace_start(const char* fileName)
+{
+	if (fileName == NULL) return -1;
+	if (InterlockedCompareExchange(&traceInitState, 1, 0) == 0) { //mutex pravi samo prva nit
+		traceMutex = CreateMutex(NULL, FALSE, NULL);
+		InterlockedExchange(&traceInitState, 2);
+	}
+	while (InterlockedCompareExchange(&traceInitState, 2, 2) != 2) SwitchToThread(); //ostale niti cekaju kraj inicijalizacije
+
+	WaitForSingleObject(traceMutex, INFINITE);
+	if (traceFile != NULL || fopen_s(&traceFile, fileName, "wb") != 0) {
+		ReleaseMutex(traceMutex); //vec se snima ili fajl ne moze da se otvori
+		return -1;
+	}
+	setvbuf(traceFile, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+	TraceHeader header;
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	memcpy(header.magic, TRACE_MAGIC, 4);
+	header.version = TRACE_VERSION;
+	header.frequency = frequency.QuadPart;
+	fwrite(&header, sizeof(TraceHeader), 1, traceFile);
+
+	tracerActive = 1;
+	ReleaseMutex(traceMutex);
+	return 0;
+}
+
+void kmem_trace_stop()
+{
+	if (traceInitState != 2) return; //snimanje nije pokretano
+
+	WaitForSingleObject(traceMutex, INFINITE);
+	tracerActive = 0;
+	if (traceFile != NULL) {
+		fclose(traceFile);
+		traceFile = NULL;
+	}
+	ReleaseMutex(traceMutex);
+}
+
+void trace_event(unsigned char type, const void* cachep, const void* objp, size_t size, const char* name)
+{
+	TraceRecord record;
+	LARGE_INTEGER timestamp;
+
+	record.type = type;
+	record.threadId = GetCurrentThreadId();
+	record.cache = (size_t) cachep;
+	record.object = (size_t) objp;
+	record.size = size;
+
+	WaitForSingleObject(traceMutex, INFINITE);
+	if (traceFile == NULL) {
+		ReleaseMutex(traceMutex); //snimanje je zaustavljeno u medjuvremenu
+		return;
+	}
+	//vreme se uzima pod mutexom da bi redosled u fajlu odgovarao vremenskom
+	QueryPerformanceCounter(&timestamp);
+	record.timestamp = timestamp.QuadPart;
+	fwrite(&record, sizeof(TraceRecord), 1, traceFile);
+	if (type == TRACE_CACHE_CREATE) {
+		char nameBuf[MAX_NAME_LENGTH] = { 0 };
+		strcpy_s(nameBuf, MAX_NAME_LENGTH, name);
+		fwrite(nameBuf, MAX_NAME_LENGTH, 1, traceFile);
+	}
+	ReleaseMutex(traceMutex);
+}
@@ -0,0 +1,41 @@
+#pragma once
+// File: trace.h
+#include "slab.h"
+
+#define TRACE_MAGIC "KMTR"
+#define TRACE_VERSION 1
+
+#define TRACE_CACHE_CREATE 1
+#define TRACE_CACHE_ALLOC 2
+#define TRACE_CACHE_FREE 3
+#define TRACE_KMALLOC 4
+#define TRACE_KFREE 5
+#define TRACE_CACHE_DESTROY 6
+#define TRACE_CACHE_SHRINK 7
+#define TRACE_KREALLOC 8 //samo rast u mestu, premestanje se snima kao kmalloc + kfree
+
+#define REPLAY_SAMPLE_EVENTS 1000
+#define REPLAY_MAX_THREADS 64
+
+#pragma pack(push, 1)
+typedef struct trace_header {
+	char magic[4];
+	int version;
+	long long frequency; //QueryPerformanceFrequency u trenutku snimanja
+} TraceHeader;
+
+//posle TRACE_CACHE_CREATE zapisa sledi ime kesa (MAX_NAME_LENGTH bajtova)
+typedef struct trace_record {
+	unsigned char type;
+	unsigned int threadId;
+	long long timestamp;
+	unsigned long long cache, object, size;
+} TraceRecord;
+#pragma pack(pop)
+
+extern volatile int tracerActive;
+
+int kmem_trace_start(const char* fileName); // Start writing allocator events to a binary trace file
+void kmem_trace_stop(); // Stop tracing and close the trace file
+
+void trace_event(unsigned char type, const void* cachep, const void* objp, size_t size, const char* name);